@@ -2,6 +2,10 @@
 #include <SDL2/SDL_image.h>
 #include "../logger/Logger.h"
 
+std::mutex AssetStore::internMutex;
+std::unordered_map<std::string, int> AssetStore::textureIndices;
+std::vector<std::string> AssetStore::assetIds;
+
 AssetStore::AssetStore() {
 
 }
@@ -10,10 +14,29 @@ AssetStore::~AssetStore() {
     ClearAssets();
 }
 
+TextureHandle AssetStore::GetTextureHandle(const std::string& assetId) {
+    if (assetId.empty()) {
+        return TextureHandle();
+    }
+
+    std::lock_guard<std::mutex> lock(internMutex);
+    auto [texture, inserted] = textureIndices.emplace(assetId, static_cast<int>(assetIds.size()));
+    if (inserted) {
+        assetIds.push_back(assetId);
+    }
+    return TextureHandle{texture->second};
+}
+
+std::string AssetStore::GetAssetId(TextureHandle handle) {
+    std::lock_guard<std::mutex> lock(internMutex);
+    return handle.index >= 0 && handle.index < static_cast<int>(assetIds.size()) ? assetIds[handle.index] : "";
+}
 
 void AssetStore::ClearAssets() {
     for(auto texture: textures) {
-        SDL_DestroyTexture(texture.second);
+        if (texture) {
+            SDL_DestroyTexture(texture);
+        }
     }
 
     textures.clear();
@@ -30,10 +53,33 @@ void AssetStore::AddTexture(SDL_Renderer* renderer, const std::string& assetId,
     }
     SDL_FreeSurface(surface);
 
-    textures.emplace(assetId, texture);
+    const TextureHandle handle = GetTextureHandle(assetId);
+    if (!handle.IsValid()) {
+        Logger::Err("Tried to add a texture without an asset id: " + filePath);
+        if (texture) {
+            SDL_DestroyTexture(texture);
+        }
+        return;
+    }
+    if (handle.index >= static_cast<int>(textures.size())) {
+        textures.resize(handle.index + 1, nullptr);
+    }
+    // The first texture of an id is kept, as with the map it replaces
+    if (!textures[handle.index]) {
+        textures[handle.index] = texture;
+    } else if (texture) {
+        SDL_DestroyTexture(texture);
+    }
 }
 
+SDL_Texture* AssetStore::GetTexture(const std::string& assetId) const {
+    std::unique_lock<std::mutex> lock(internMutex);
+    auto texture = textureIndices.find(assetId);
+    if (texture == textureIndices.end()) {
+        return nullptr;
+    }
+    const int index = texture->second;
+    lock.unlock();
 
-SDL_Texture* AssetStore::GetTexture(const std::string& assetId) {
-    return textures[assetId];
-}
\ No newline at end of file
+    return GetTexture(TextureHandle{index});
+}
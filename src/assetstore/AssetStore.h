@@ -1,21 +1,48 @@
 #ifndef ASSETSTORE_H
 #define ASSETSTORE_H
 
-#include <map>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <SDL2/SDL.h>
 
+// Interned asset id. It is the index of the texture in the flat array of
+// every store, and the same for all the stores of the process.
+struct TextureHandle {
+    int index = -1;
+
+    bool IsValid() const { return index != -1; }
+    bool operator ==(const TextureHandle& other) const { return index == other.index; }
+    bool operator !=(const TextureHandle& other) const { return index != other.index; }
+};
+
 class AssetStore {
     private:
-        std::map<std::string, SDL_Texture*> textures;
+        // Indexed by handle, nullptr for the assets not loaded in this store
+        std::vector<SDL_Texture*> textures;
+
+        static std::mutex internMutex;
+        static std::unordered_map<std::string, int> textureIndices;
+        static std::vector<std::string> assetIds;
 
     public:
         AssetStore();
         ~AssetStore();
 
+        // Handle of an asset id, interned on first use. Thread-safe, so that
+        // sprites can be created anywhere; an empty id has an invalid handle.
+        static TextureHandle GetTextureHandle(const std::string& assetId);
+        static std::string GetAssetId(TextureHandle handle);
+
         void ClearAssets();
         void AddTexture(SDL_Renderer *renderer, const std::string& assetId, const std::string& filePath);
-        SDL_Texture* GetTexture(const std::string& assetId);
+        // Read-only, so that worlds stepped on other threads can share the store
+        SDL_Texture* GetTexture(const std::string& assetId) const;
+
+        SDL_Texture* GetTexture(TextureHandle handle) const {
+            return handle.index >= 0 && handle.index < static_cast<int>(textures.size()) ? textures[handle.index] : nullptr;
+        }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "Bench.h"
+#include "../jobs/JobSystem.h"
+
+// Overhead of spawning and stealing jobs, and how a CPU-bound batch scales
+// from 1 to N threads. Usage: JobBench [maxThreads]
+
+static const int numEmptyJobs = 200000;
+static const int numWorkJobs = 4096;
+static const int workIterations = 20000;
+
+static std::atomic<double> workSink{0.0};
+
+static void Work(int seed) {
+  double value = seed;
+  for (int i = 0; i < workIterations; i++) {
+    value = std::sqrt(value + i);
+  }
+  workSink.store(value, std::memory_order_relaxed);
+}
+
+// Nanoseconds per job for empty jobs, all queued on the given thread
+static double MeasureEmptyJobs(JobSystem& jobSystem, int threadHint) {
+  JobCounter counter;
+  const double elapsedMs = MeasureMs([&] {
+    for (int i = 0; i < numEmptyJobs; i++) {
+      jobSystem.Schedule([] {}, counter, threadHint);
+    }
+    jobSystem.Wait(counter);
+  });
+  return elapsedMs * 1e6 / numEmptyJobs;
+}
+
+static double MeasureWork(JobSystem& jobSystem) {
+  JobCounter counter;
+  return MeasureMs([&] {
+    for (int i = 0; i < numWorkJobs; i++) {
+      jobSystem.Schedule([i] { Work(i); }, counter);
+    }
+    jobSystem.Wait(counter);
+  });
+}
+
+int main(int argc, char* argv[]) {
+  const int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+  const int maxThreads = argc > 1 ? std::atoi(argv[1]) : hardwareThreads;
+
+  std::vector<int> threadCounts;
+  for (int numThreads = 1; numThreads < maxThreads; numThreads *= 2) {
+    threadCounts.push_back(numThreads);
+  }
+  threadCounts.push_back(maxThreads);
+
+  std::printf("%d empty jobs, %d jobs of %d iterations\n", numEmptyJobs, numWorkJobs, workIterations);
+  std::printf("threads  spawn ns/job  steal ns/job  work ms  speedup\n");
+  double serialWorkMs = 0.0;
+  for (auto numThreads : threadCounts) {
+    JobSystem jobSystem(numThreads);
+
+    // Jobs queued on the calling thread, run by it and stolen by the workers
+    const double spawnNs = MeasureEmptyJobs(jobSystem, -1);
+    // Jobs queued on the last worker, every other thread has to steal them
+    const double stealNs = MeasureEmptyJobs(jobSystem, numThreads - 1);
+    const double workMs = MeasureWork(jobSystem);
+    if (numThreads == 1) {
+      serialWorkMs = workMs;
+    }
+
+    std::printf("%7d  %12.1f  %12.1f  %7.1f  %7.2f\n", numThreads, spawnNs, stealNs, workMs,
+                serialWorkMs > 0.0 ? serialWorkMs / workMs : 1.0);
+  }
+
+  return 0;
+}
@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Bench.h"
+#include "../ecs/ECS.h"
+#include "../components/Components.h"
+#include "../systems/MovementSystem.h"
+
+// Throughput of MovementSystem, which moves its entities with
+// ComponentView::ParallelEach, at 1 to N threads. Small entity counts fit in
+// one batch and run serially on the calling thread.
+// Usage: ParallelEachBench [numEntities] [maxThreads]
+
+static const int numFrames = 20;
+static const double deltaTime = 1.0 / 60.0;
+
+static void AddMovingEntities(Registry& registry, int numEntities) {
+  std::vector<Entity> entities = registry.CreateEntities(numEntities);
+  std::vector<TransformComponent> transforms(numEntities);
+  std::vector<RigidBodyComponent> rigidBodies(numEntities, RigidBodyComponent(glm::vec2(10.0, 20.0)));
+  registry.AddComponents<TransformComponent>(entities, std::move(transforms));
+  registry.AddComponents<RigidBodyComponent>(entities, std::move(rigidBodies));
+  registry.Update();
+}
+
+// Milliseconds per frame
+static double MeasureMovement(Registry& registry, JobSystem& jobSystem) {
+  auto& movementSystem = registry.GetSystem<MovementSystem>();
+  return MeasureMs([&] {
+    for (int frame = 0; frame < numFrames; frame++) {
+      movementSystem.Update(deltaTime, registry, jobSystem);
+    }
+  }) / numFrames;
+}
+
+int main(int argc, char* argv[]) {
+  const int numEntities = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  const int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+  const int maxThreads = argc > 2 ? std::atoi(argv[2]) : hardwareThreads;
+
+  std::vector<int> threadCounts;
+  for (int numThreads = 1; numThreads < maxThreads; numThreads *= 2) {
+    threadCounts.push_back(numThreads);
+  }
+  threadCounts.push_back(maxThreads);
+
+  for (auto storage : {STORAGE_POOL, STORAGE_ARCHETYPE}) {
+    Registry registry(storage);
+    registry.AddSystem<MovementSystem>();
+    AddMovingEntities(registry, numEntities);
+
+    // Plain Each as the serial baseline
+    const double serialMs = MeasureMs([&] {
+      for (int frame = 0; frame < numFrames; frame++) {
+        registry.View<TransformComponent, const RigidBodyComponent>().Each(
+            [](Entity, TransformComponent& transform, const RigidBodyComponent& rigidBody) {
+              transform.position.x += rigidBody.velocity.x * deltaTime;
+              transform.position.y += rigidBody.velocity.y * deltaTime;
+            });
+      }
+    }) / numFrames;
+
+    std::printf("%s storage, %d entities\n", storage == STORAGE_POOL ? "pool" : "archetype", numEntities);
+    std::printf("threads  ms/frame  Mentities/s  speedup\n");
+    std::printf("%7s  %8.3f  %11.1f  %7.2f\n", "Each", serialMs, numEntities / serialMs / 1000.0, 1.0);
+    for (auto numThreads : threadCounts) {
+      JobSystem jobSystem(numThreads);
+      const double frameMs = MeasureMovement(registry, jobSystem);
+      std::printf("%7d  %8.3f  %11.1f  %7.2f\n", numThreads, frameMs, numEntities / frameMs / 1000.0,
+                  serialMs / frameMs);
+    }
+  }
+
+  return 0;
+}
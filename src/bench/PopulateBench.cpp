@@ -0,0 +1,85 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Bench.h"
+#include "../ecs/ECS.h"
+#include "../components/Components.h"
+
+// Time to populate a tilemap like Game::Setup does, one entity with a
+// transform and a sprite per tile. Usage: PopulateBench [numTiles]
+
+static const int tileSize = 32;
+static const double tileScale = 2.0;
+
+static TransformComponent TileTransform(int tile) {
+  return TransformComponent(glm::vec2((tile % 1000) * tileScale * tileSize, (tile / 1000) * tileScale * tileSize),
+                            glm::vec2(tileScale, tileScale), 0.0);
+}
+
+static SpriteComponent TileSprite(int tile) {
+  return SpriteComponent("tilemap-image", tileSize, tileSize, 0, (tile % 10) * tileSize, (tile % 3) * tileSize);
+}
+
+static void ReserveTiles(Registry& registry, int numTiles) {
+  registry.ReserveEntities(numTiles);
+  registry.Reserve<TransformComponent>(numTiles);
+  registry.Reserve<SpriteComponent>(numTiles);
+}
+
+// One entity at a time
+static void PopulateOneByOne(Registry& registry, int numTiles) {
+  for (int tile = 0; tile < numTiles; tile++) {
+    Entity entity = registry.CreateEntity();
+    registry.AddComponent<TransformComponent>(entity, TileTransform(tile));
+    registry.AddComponent<SpriteComponent>(entity, TileSprite(tile));
+  }
+  registry.Update();
+}
+
+// With CreateEntities and AddComponents, as Game::Setup does
+static void PopulateBulk(Registry& registry, int numTiles) {
+  std::vector<Entity> tiles = registry.CreateEntities(numTiles);
+  std::vector<TransformComponent> transforms;
+  std::vector<SpriteComponent> sprites;
+  transforms.reserve(numTiles);
+  sprites.reserve(numTiles);
+  for (int tile = 0; tile < numTiles; tile++) {
+    transforms.push_back(TileTransform(tile));
+    sprites.push_back(TileSprite(tile));
+  }
+  registry.AddComponents<TransformComponent>(tiles, std::move(transforms));
+  registry.AddComponents<SpriteComponent>(tiles, std::move(sprites));
+  registry.Update();
+}
+
+// Milliseconds to populate a new registry, the reservation included
+template <typename TPopulate>
+static double MeasurePopulate(StorageType storage, int numTiles, bool reserve, TPopulate populate) {
+  Registry registry(storage);
+  return MeasureMs([&] {
+    if (reserve) {
+      ReserveTiles(registry, numTiles);
+    }
+    populate(registry, numTiles);
+  });
+}
+
+int main(int argc, char* argv[]) {
+  const int numTiles = argc > 1 ? std::atoi(argv[1]) : 1000000;
+
+  std::printf("Populating %d tiles, in ms\n", numTiles);
+  std::printf("storage    reserved  one by one      bulk\n");
+  for (auto storage : {STORAGE_POOL, STORAGE_ARCHETYPE}) {
+    for (bool reserve : {false, true}) {
+      const double oneByOneMs = MeasurePopulate(storage, numTiles, reserve, PopulateOneByOne);
+      const double bulkMs = MeasurePopulate(storage, numTiles, reserve, PopulateBulk);
+      std::printf("%-9s  %8s  %10.1f  %8.1f\n", storage == STORAGE_POOL ? "pool" : "archetype",
+                  reserve ? "yes" : "no", oneByOneMs, bulkMs);
+    }
+  }
+
+  return 0;
+}
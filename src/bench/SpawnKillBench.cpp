@@ -0,0 +1,63 @@
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+
+#include <glm/glm.hpp>
+
+#include "Bench.h"
+#include "../ecs/ECS.h"
+#include "../components/Components.h"
+#include "../systems/MovementSystem.h"
+#include "../systems/CollisionSystem.h"
+#include "../systems/RenderSystem.h"
+
+// Spawns and kills projectiles at a steady rate, each one living for a
+// second, to measure the cost of the membership changes of the systems.
+// Usage: SpawnKillBench [projectilesPerSecond] [seconds]
+
+static const int framesPerSecond = 60;
+
+int main(int argc, char* argv[]) {
+  const int projectilesPerSecond = argc > 1 ? std::atoi(argv[1]) : 50000;
+  const int seconds = argc > 2 ? std::atoi(argv[2]) : 5;
+  const int projectilesPerFrame = projectilesPerSecond / framesPerSecond;
+
+  std::printf("Spawning and killing %d projectiles per second for %d seconds at %d fps\n",
+              projectilesPerFrame * framesPerSecond, seconds, framesPerSecond);
+  for (auto storage : {STORAGE_POOL, STORAGE_ARCHETYPE}) {
+    Registry registry(storage);
+    registry.AddSystem<MovementSystem>();
+    registry.AddSystem<CollisionSystem>();
+    registry.AddSystem<RenderSystem>();
+
+    std::deque<Entity> projectiles;
+    const double elapsedMs = MeasureMs([&] {
+      for (int frame = 0; frame < seconds * framesPerSecond; frame++) {
+        for (int i = 0; i < projectilesPerFrame; i++) {
+          Entity projectile = registry.CreateEntity();
+          registry.AddComponent<TransformComponent>(projectile, glm::vec2(i, frame));
+          registry.AddComponent<RigidBodyComponent>(projectile, glm::vec2(100.0, 0.0));
+          registry.AddComponent<SpriteComponent>(projectile, "bullet-image", 4, 4, 2);
+          registry.AddComponent<BoxColliderComponent>(projectile, 4, 4);
+          projectiles.push_back(projectile);
+        }
+
+        // Projectiles spawned a second ago expire
+        if (static_cast<int>(projectiles.size()) > projectilesPerFrame * framesPerSecond) {
+          for (int i = 0; i < projectilesPerFrame; i++) {
+            registry.KillEntity(projectiles.front());
+            projectiles.pop_front();
+          }
+        }
+
+        registry.Update();
+      }
+    });
+
+    std::printf("%-9s %8.1f ms, %.3f ms per frame, %.1f%% of real time\n",
+                storage == STORAGE_POOL ? "pool" : "archetype", elapsedMs, elapsedMs / (seconds * framesPerSecond),
+                100.0 * elapsedMs / (seconds * 1000.0));
+  }
+
+  return 0;
+}
@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Bench.h"
+#include "../ecs/ECS.h"
+#include "../components/Components.h"
+#include "../assetstore/AssetStore.h"
+#include "../memory/FrameArena.h"
+#include "../game/World.h"
+
+// Ticks per second of isolated worlds stepped concurrently with
+// World::StepAll, at 1 to N threads. Every world holds its own moving and
+// animated entities. Usage: WorldBench [numWorlds] [maxThreads]
+
+static const int numEntitiesPerWorld = 2000;
+static const int numTicks = 300;
+static const double deltaTime = 1.0 / 60.0;
+
+static void PopulateWorld(World& world, int worldIndex) {
+  Registry& registry = world.GetRegistry();
+  for (int i = 0; i < numEntitiesPerWorld; i++) {
+    Entity entity = registry.CreateEntity();
+    registry.AddComponent<TransformComponent>(entity, glm::vec2(i * 40.0, (i % 50) * 40.0 + worldIndex),
+                                              glm::vec2(1.0, 1.0), 0.0);
+    registry.AddComponent<RigidBodyComponent>(entity, glm::vec2(10.0, 5.0));
+    if (i % 4 == 0) {
+      registry.AddComponent<SpriteComponent>(entity, "chopper-image", 32, 32, 1);
+      registry.AddComponent<AnimationComponent>(entity, 2, 5, true);
+    }
+  }
+}
+
+int main(int argc, char* argv[]) {
+  const int numWorlds = argc > 1 ? std::atoi(argv[1]) : 64;
+  const int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+  const int maxThreads = argc > 2 ? std::atoi(argv[2]) : hardwareThreads;
+
+  std::vector<int> threadCounts;
+  for (int numThreads = 1; numThreads < maxThreads; numThreads *= 2) {
+    threadCounts.push_back(numThreads);
+  }
+  threadCounts.push_back(maxThreads);
+
+  AssetStore assetStore;
+  FrameArena frameArena;
+
+  std::printf("%d worlds of %d entities, %d ticks\n", numWorlds, numEntitiesPerWorld, numTicks);
+  std::printf("threads  world ticks/s  frames/s  speedup\n");
+  double serialTicksPerSecond = 0.0;
+  for (auto numThreads : threadCounts) {
+    JobSystem jobSystem(numThreads);
+    std::vector<std::unique_ptr<World>> worlds;
+    for (int worldIndex = 0; worldIndex < numWorlds; worldIndex++) {
+      worlds.push_back(std::make_unique<World>(assetStore, jobSystem, frameArena));
+      PopulateWorld(*worlds.back(), worldIndex);
+    }
+
+    const double elapsedMs = MeasureMs([&] {
+      for (int tick = 0; tick < numTicks; tick++) {
+        frameArena.Reset();
+        World::StepAll(worlds, deltaTime, jobSystem);
+      }
+    });
+    const double ticksPerSecond = numWorlds * numTicks / (elapsedMs / 1000.0);
+    if (numThreads == 1) {
+      serialTicksPerSecond = ticksPerSecond;
+    }
+
+    std::printf("%7d  %13.0f  %8.1f  %7.2f\n", numThreads, ticksPerSecond, ticksPerSecond / numWorlds,
+                serialTicksPerSecond > 0.0 ? ticksPerSecond / serialTicksPerSecond : 1.0);
+  }
+
+  return 0;
+}
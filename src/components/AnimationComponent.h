@@ -1,6 +1,8 @@
 #ifndef ANIMATIONCOMPONENT_H
 #define ANIMATIONCOMPONENT_H
 
+#include "Components.h"
+
 #include <string>
 #include <SDL2/SDL.h>
 
@@ -1,6 +1,8 @@
 #ifndef BOXCOLLIDERCOMPONENT_H
 #define BOXCOLLIDERCOMPONENT_H
 
+#include "Components.h"
+
 #include <glm/glm.hpp>
 
 struct BoxColliderComponent {
@@ -0,0 +1,41 @@
+#ifndef COMPONENTS_H
+#define COMPONENTS_H
+
+#include "../ecs/ECS.h"
+
+// The ids of the game components are assigned at compile time. Every
+// component header includes this one first, so a translation unit cannot
+// meet one of them before the list, which would give it a runtime id there
+// and a static id everywhere else.
+struct TransformComponent;
+struct RigidBodyComponent;
+struct SpriteComponent;
+struct BoxColliderComponent;
+struct AnimationComponent;
+struct HierarchyComponent;
+struct StaticTag;
+struct PlayerTag;
+struct EnemyTag;
+struct OffscreenTag;
+
+ECS_STATIC_COMPONENTS(
+    TransformComponent,
+    RigidBodyComponent,
+    SpriteComponent,
+    BoxColliderComponent,
+    AnimationComponent,
+    HierarchyComponent,
+    StaticTag,
+    PlayerTag,
+    EnemyTag,
+    OffscreenTag);
+
+#include "TransformComponent.h"
+#include "RigidBodyComponent.h"
+#include "SpriteComponent.h"
+#include "BoxColliderComponent.h"
+#include "AnimationComponent.h"
+#include "HierarchyComponent.h"
+#include "TagComponents.h"
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef HIERARCHYCOMPONENT_H
+#define HIERARCHYCOMPONENT_H
+
+#include "Components.h"
+#include "../ecs/ECS.h"
+
+// Attaches an entity to a parent. The TransformComponent of the entity is
+// then relative to the world transform of the parent.
+struct HierarchyComponent {
+    Entity parent;
+
+    HierarchyComponent(Entity parent = Entity(-1)) : parent(parent) {}
+};
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef RIGIGBODYCOMPONENT_H
 #define RIGIGBODYCOMPONENT_H
 
+#include "Components.h"
+
 #include <glm/glm.hpp>
 
 struct RigidBodyComponent {
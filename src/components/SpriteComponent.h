@@ -1,18 +1,27 @@
 #ifndef SPRITECOMPONENT_H
 #define SPRITECOMPONENT_H 
 
+#include "Components.h"
+
+#include <new>
 #include <string>
+#include <type_traits>
 #include <SDL2/SDL.h>
+#include "../ecs/ECS.h"
+#include "../assetstore/AssetStore.h"
 
 struct SpriteComponent {
-    std::string assetId;
+    TextureHandle texture;
     int width;
     int height;
     int zIndex;
     SDL_Rect srcRect;
 
-    SpriteComponent(std::string assetId = "", int width = 0, int height = 0, int zIndex = 0, int srcRectX = 0, int srcRectY = 0) {
-        this->assetId = assetId;
+    SpriteComponent(const std::string& assetId = "", int width = 0, int height = 0, int zIndex = 0, int srcRectX = 0, int srcRectY = 0)
+        : SpriteComponent(AssetStore::GetTextureHandle(assetId), width, height, zIndex, srcRectX, srcRectY) {}
+
+    SpriteComponent(TextureHandle texture, int width = 0, int height = 0, int zIndex = 0, int srcRectX = 0, int srcRectY = 0) {
+        this->texture = texture;
         this->width = width;
         this->height = height;
         this->zIndex = zIndex;
@@ -20,4 +29,30 @@ struct SpriteComponent {
     }
 };
 
-#endif
\ No newline at end of file
+static_assert(std::is_trivially_copyable<SpriteComponent>::value, "Sprites are copied as bytes");
+
+// Handles depend on the order the asset ids were interned in, so sprites are
+// saved with their asset id
+template <>
+struct ComponentSerializer<SpriteComponent> {
+    static void Write(SnapshotWriter& writer, const SpriteComponent& sprite) {
+        writer.Write(AssetStore::GetAssetId(sprite.texture));
+        writer.Write(sprite.width);
+        writer.Write(sprite.height);
+        writer.Write(sprite.zIndex);
+        writer.Write(sprite.srcRect);
+    }
+
+    static void Read(SnapshotReader& reader, void* destination) {
+        auto* sprite = new (destination) SpriteComponent();
+        std::string assetId;
+        reader.Read(assetId);
+        sprite->texture = AssetStore::GetTextureHandle(assetId);
+        reader.Read(sprite->width);
+        reader.Read(sprite->height);
+        reader.Read(sprite->zIndex);
+        reader.Read(sprite->srcRect);
+    }
+};
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef TAGCOMPONENTS_H
+#define TAGCOMPONENTS_H
+
+#include "Components.h"
+
+// Tags carry no data, an entity either has them or not. They never allocate
+// storage and are matched with ComponentView::With and Without.
+
+// Never moves, like the tiles of the map
+struct StaticTag {};
+
+struct PlayerTag {};
+
+struct EnemyTag {};
+
+// Outside of the camera
+struct OffscreenTag {};
+
+#endif
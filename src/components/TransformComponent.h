@@ -1,6 +1,8 @@
 #ifndef TRANSFORMCOMPONENT_H
 #define TRANSFORMCOMPONENT_H
 
+#include "Components.h"
+
 #include <glm/glm.hpp>
 
 struct TransformComponent {
@@ -1,32 +1,530 @@
 #include "ECS.h"
 
 #include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "../logger/Logger.h"
 
-int IComponent::nextId = 0;
+std::atomic<int> IComponent::nextId{0};
+ComponentTypeInfo IComponent::typeInfos[MAX_COMPONENTS];
+
+// First bytes of every registry snapshot, "ECSS", and the version of its
+// layout. Bump the version whenever the layout changes.
+static const unsigned int SNAPSHOT_MAGIC = 0x53534345;
+static const unsigned int SNAPSHOT_VERSION = 1;
 
-int Entity::GetId() const { return id; }
+// World files start with this header, followed by a snapshot whose bulk
+// component data is moved to the sections, which start on a page boundary
+struct WorldFileHeader {
+  // "ECSW"
+  unsigned int magic;
+  unsigned int version;
+  unsigned long long snapshotOffset;
+  unsigned long long snapshotSize;
+  unsigned long long sectionsOffset;
+  unsigned long long sectionsSize;
+};
 
-void Entity::Kill() {
-    registry->KillEntity(*this);
-} 
+static const unsigned int WORLD_FILE_MAGIC = 0x57534345;
+static const unsigned int WORLD_FILE_VERSION = 1;
 
-void System::AddEntityToSystem(Entity entity) { entities.push_back(entity); }
+void System::AddEntityToSystem(Entity entity) {
+  if (HasEntity(entity)) {
+    return;
+  }
+
+  GrowToFit(entityIdToIndex, entity.GetId(), -1);
+  entityIdToIndex[entity.GetId()] = entities.size();
+  entities.push_back(entity);
+  membershipVersion++;
+}
 
 void System::RemoveEntityFromSystem(Entity entity) {
-  entities.erase(
-      std::remove_if(entities.begin(), entities.end(),
-                     [&entity](Entity other) { return entity == other; }),
-      entities.end());
+  if (!HasEntity(entity)) {
+    return;
+  }
+
+  // Move the last entity into the slot of the removed one
+  const int index = entityIdToIndex[entity.GetId()];
+  const Entity last = entities.back();
+  entities[index] = last;
+  entityIdToIndex[last.GetId()] = index;
+
+  entities.pop_back();
+  entityIdToIndex[entity.GetId()] = -1;
+  membershipVersion++;
+}
+
+bool System::HasEntity(Entity entity) const {
+  return entity.GetId() < static_cast<int>(entityIdToIndex.size()) &&
+         entityIdToIndex[entity.GetId()] != -1 &&
+         entities[entityIdToIndex[entity.GetId()]] == entity;
 }
 
-std::vector<Entity> System::GetSystemEntities() const { return entities; }
+const std::vector<Entity>& System::GetSystemEntities() const { return entities; }
+
+void System::SetSystemEntities(const std::vector<Entity>& entities) {
+  for (auto entity : this->entities) {
+    entityIdToIndex[entity.GetId()] = -1;
+  }
+
+  this->entities = entities;
+  int maxEntityId = -1;
+  for (auto entity : entities) {
+    maxEntityId = std::max(maxEntityId, entity.GetId());
+  }
+  GrowToFit(entityIdToIndex, maxEntityId, -1);
+  for (unsigned int index = 0; index < entities.size(); index++) {
+    entityIdToIndex[entities[index].GetId()] = index;
+  }
+  membershipVersion++;
+}
 
 const Signature& System::GetComponentSignature() const {
   return componentSignature;
 }
 
+bool System::ConflictsWith(const System& other) const {
+  return (writeSignature & (other.readSignature | other.writeSignature)).any() ||
+         (other.writeSignature & readSignature).any();
+}
+
+Archetype::Archetype(const Signature& signature) : signature(signature) {
+  componentIdToColumn.resize(MAX_COMPONENTS, -1);
+
+  int rowSize = sizeof(int);
+  // Tags have no column, only their bit in the signature
+  for (unsigned int componentId = 0; componentId < MAX_COMPONENTS; componentId++) {
+    if (signature.test(componentId) && IComponent::GetTypeInfo(componentId).size > 0) {
+      componentIdToColumn[componentId] = componentIds.size();
+      componentIds.push_back(componentId);
+      rowSize += IComponent::GetTypeInfo(componentId).size;
+    }
+  }
+  addedTicks.resize(componentIds.size());
+  changedTicks.resize(componentIds.size());
+
+  // Fit as many rows as possible in a chunk, leaving room for the padding
+  // needed to align every column
+  chunkCapacity = std::max(1, static_cast<int>(ARCHETYPE_CHUNK_SIZE / rowSize));
+  while (true) {
+    int offset = chunkCapacity * sizeof(int);
+    columnOffsets.clear();
+
+    for (auto componentId : componentIds) {
+      const auto& typeInfo = IComponent::GetTypeInfo(componentId);
+      offset = (offset + typeInfo.alignment - 1) / typeInfo.alignment * typeInfo.alignment;
+      columnOffsets.push_back(offset);
+      offset += chunkCapacity * typeInfo.size;
+    }
+
+    if (offset <= static_cast<int>(ARCHETYPE_CHUNK_SIZE)) {
+      break;
+    }
+
+    if (chunkCapacity == 1) {
+      Logger::Err("Archetype row does not fit in a chunk");
+      break;
+    }
+    chunkCapacity--;
+  }
+}
+
+Archetype::~Archetype() {
+  for (int row = 0; row < numRows; row++) {
+    DestroyRow(row);
+  }
+}
+
+int Archetype::GetChunkSize(int chunkIndex) const {
+  return std::min(chunkCapacity, numRows - chunkIndex * chunkCapacity);
+}
+
+int* Archetype::GetEntityIds(int chunkIndex) {
+  return reinterpret_cast<int*>(chunks[chunkIndex]->bytes);
+}
+
+void* Archetype::GetColumnData(int chunkIndex, int column) {
+  return chunks[chunkIndex]->bytes + columnOffsets[column];
+}
+
+void* Archetype::GetComponent(int row, int column) {
+  const auto& typeInfo = IComponent::GetTypeInfo(componentIds[column]);
+  unsigned char* columnData = static_cast<unsigned char*>(
+      GetColumnData(row / chunkCapacity, column));
+
+  return columnData + (row % chunkCapacity) * typeInfo.size;
+}
+
+int Archetype::AddRow(int entityId) {
+  const int row = numRows++;
+  const int chunkIndex = row / chunkCapacity;
+
+  if (chunkIndex >= static_cast<int>(chunks.size())) {
+    chunks.push_back(std::make_unique<ArchetypeChunk>());
+  }
+  GetEntityIds(chunkIndex)[row % chunkCapacity] = entityId;
+
+  for (unsigned int column = 0; column < componentIds.size(); column++) {
+    addedTicks[column].push_back(0);
+    changedTicks[column].push_back(0);
+  }
+
+  return row;
+}
+
+int Archetype::CloneRow(int sourceRow, const std::vector<int>& entityIds, unsigned int tick) {
+  const int firstRow = numRows;
+  for (auto entityId : entityIds) {
+    AddRow(entityId);
+  }
+
+  for (unsigned int column = 0; column < componentIds.size(); column++) {
+    const auto& typeInfo = IComponent::GetTypeInfo(componentIds[column]);
+    const void* source = GetComponent(sourceRow, column);
+
+    if (typeInfo.triviallyCopyable) {
+      for (int row = firstRow; row < numRows; row++) {
+        std::memcpy(GetComponent(row, column), source, typeInfo.size);
+      }
+    } else {
+      for (int row = firstRow; row < numRows; row++) {
+        typeInfo.copyConstruct(GetComponent(row, column), source);
+      }
+    }
+
+    std::fill(addedTicks[column].begin() + firstRow, addedTicks[column].end(), tick);
+    std::fill(changedTicks[column].begin() + firstRow, changedTicks[column].end(), tick);
+  }
+
+  return firstRow;
+}
+
+int Archetype::RemoveRow(int row) {
+  const int lastRow = --numRows;
+
+  for (unsigned int column = 0; column < componentIds.size(); column++) {
+    addedTicks[column][row] = addedTicks[column][lastRow];
+    changedTicks[column][row] = changedTicks[column][lastRow];
+    addedTicks[column].pop_back();
+    changedTicks[column].pop_back();
+  }
+
+  if (row == lastRow) {
+    return -1;
+  }
+
+  for (unsigned int column = 0; column < componentIds.size(); column++) {
+    const auto& typeInfo = IComponent::GetTypeInfo(componentIds[column]);
+    void* last = GetComponent(lastRow, column);
+    typeInfo.moveConstruct(GetComponent(row, column), last);
+    typeInfo.destroy(last);
+  }
+
+  const int movedEntityId = GetEntityIds(lastRow / chunkCapacity)[lastRow % chunkCapacity];
+  GetEntityIds(row / chunkCapacity)[row % chunkCapacity] = movedEntityId;
+
+  return movedEntityId;
+}
+
+void Archetype::DestroyRow(int row) {
+  for (unsigned int column = 0; column < componentIds.size(); column++) {
+    IComponent::GetTypeInfo(componentIds[column]).destroy(GetComponent(row, column));
+  }
+}
+
+int ArchetypeStorage::GetOrCreateArchetype(const Signature& signature) {
+  auto archetype = archetypeIndices.find(signature);
+  if (archetype != archetypeIndices.end()) {
+    return archetype->second;
+  }
+
+  const int archetypeIndex = archetypes.size();
+  archetypes.push_back(std::make_unique<Archetype>(signature));
+  archetypeIndices.emplace(signature, archetypeIndex);
+
+  return archetypeIndex;
+}
+
+int ArchetypeStorage::MoveEntity(int entityId, const Signature& signature) {
+  auto& location = entityLocations[entityId];
+  const int newArchetypeIndex = signature.none() ? -1 : GetOrCreateArchetype(signature);
+  int newRow = -1;
+
+  if (newArchetypeIndex != -1) {
+    newRow = archetypes[newArchetypeIndex]->AddRow(entityId);
+  }
+
+  if (location.archetype != -1) {
+    auto& oldArchetype = archetypes[location.archetype];
+
+    for (auto componentId : oldArchetype->GetComponentIds()) {
+      const auto& typeInfo = IComponent::GetTypeInfo(componentId);
+      void* component = oldArchetype->GetComponent(location.row, oldArchetype->GetColumn(componentId));
+
+      if (signature.test(componentId)) {
+        auto& newArchetype = archetypes[newArchetypeIndex];
+        const int oldColumn = oldArchetype->GetColumn(componentId);
+        const int newColumn = newArchetype->GetColumn(componentId);
+        typeInfo.moveConstruct(newArchetype->GetComponent(newRow, newColumn), component);
+        newArchetype->GetAddedTicks(newColumn)[newRow] = oldArchetype->GetAddedTicks(oldColumn)[location.row];
+        newArchetype->GetChangedTicks(newColumn)[newRow] = oldArchetype->GetChangedTicks(oldColumn)[location.row];
+      }
+      typeInfo.destroy(component);
+    }
+
+    const int movedEntityId = oldArchetype->RemoveRow(location.row);
+    if (movedEntityId != -1) {
+      entityLocations[movedEntityId].row = location.row;
+    }
+  }
+
+  location.archetype = newArchetypeIndex;
+  location.row = newRow;
+
+  return newRow;
+}
+
+void ArchetypeStorage::RemoveComponent(int entityId, int componentId) {
+  Signature signature = archetypes[entityLocations[entityId].archetype]->GetSignature();
+  signature.reset(componentId);
+
+  MoveEntity(entityId, signature);
+}
+
+unsigned int ArchetypeStorage::GetAddedTick(int entityId, int componentId) const {
+  const auto& location = entityLocations[entityId];
+  auto& archetype = archetypes[location.archetype];
+  return archetype->GetAddedTicks(archetype->GetColumn(componentId))[location.row];
+}
+
+unsigned int ArchetypeStorage::GetChangedTick(int entityId, int componentId) const {
+  const auto& location = entityLocations[entityId];
+  auto& archetype = archetypes[location.archetype];
+  return archetype->GetChangedTicks(archetype->GetColumn(componentId))[location.row];
+}
+
+void ArchetypeStorage::SetChangedTick(int entityId, int componentId, unsigned int tick) {
+  const auto& location = entityLocations[entityId];
+  auto& archetype = archetypes[location.archetype];
+  archetype->GetChangedTicks(archetype->GetColumn(componentId))[location.row] = tick;
+}
+
+void ArchetypeStorage::RemoveEntity(int entityId) {
+  if (entityId < static_cast<int>(entityLocations.size()) &&
+      entityLocations[entityId].archetype != -1) {
+    MoveEntity(entityId, Signature());
+  }
+}
+
+void ArchetypeStorage::CloneEntity(int sourceEntityId, const std::vector<int>& entityIds, unsigned int tick) {
+  const EntityLocation source = entityLocations[sourceEntityId];
+  if (source.archetype == -1 || entityIds.empty()) {
+    return;
+  }
+
+  const int firstRow = archetypes[source.archetype]->CloneRow(source.row, entityIds, tick);
+
+  for (unsigned int i = 0; i < entityIds.size(); i++) {
+    GrowToFit(entityLocations, entityIds[i]);
+    entityLocations[entityIds[i]] = {source.archetype, firstRow + static_cast<int>(i)};
+  }
+}
+
+void ArchetypeStorage::Clear() {
+  archetypes.clear();
+  archetypeIndices.clear();
+  entityLocations.clear();
+}
+
+void ArchetypeStorage::Write(SnapshotWriter& writer) const {
+  int numArchetypes = 0;
+  for (const auto& archetype : archetypes) {
+    numArchetypes += archetype->GetNumRows() > 0;
+  }
+  writer.Write(numArchetypes);
+
+  for (const auto& archetype : archetypes) {
+    if (archetype->GetNumRows() == 0) {
+      continue;
+    }
+
+    // The columns are described up front, so that a blob that does not match
+    // the registered components is rejected before any row is added
+    const auto& componentIds = archetype->GetComponentIds();
+    writer.Write(archetype->GetSignature());
+    writer.Write(static_cast<int>(componentIds.size()));
+    for (auto componentId : componentIds) {
+      writer.Write(componentId);
+      writer.Write(static_cast<unsigned int>(IComponent::GetTypeInfo(componentId).size));
+    }
+
+    writer.Write(archetype->GetNumRows());
+    for (int chunk = 0; chunk < archetype->GetNumChunks(); chunk++) {
+      writer.Write(archetype->GetEntityIds(chunk), archetype->GetChunkSize(chunk) * sizeof(int));
+    }
+
+    for (unsigned int column = 0; column < componentIds.size(); column++) {
+      const auto& typeInfo = IComponent::GetTypeInfo(componentIds[column]);
+
+      if (typeInfo.savedAsBytes) {
+        // One copy per chunk
+        for (int chunk = 0; chunk < archetype->GetNumChunks(); chunk++) {
+          writer.Write(archetype->GetColumnData(chunk, column), archetype->GetChunkSize(chunk) * typeInfo.size);
+        }
+      } else {
+        for (int row = 0; row < archetype->GetNumRows(); row++) {
+          typeInfo.write(writer, archetype->GetComponent(row, column));
+        }
+      }
+    }
+  }
+}
+
+bool ArchetypeStorage::Read(SnapshotReader& reader, int numEntities, unsigned int tick) {
+  Clear();
+
+  int numArchetypes = 0;
+  reader.ReadCount(numArchetypes, sizeof(Signature));
+
+  for (int i = 0; i < numArchetypes && !reader.Failed(); i++) {
+    Signature signature;
+    int numColumns = 0;
+    reader.Read(signature);
+    reader.ReadCount(numColumns, 2 * sizeof(int));
+    if (reader.Failed() || signature.none() || archetypeIndices.count(signature)) {
+      return false;
+    }
+
+    const int archetypeIndex = GetOrCreateArchetype(signature);
+    auto& archetype = archetypes[archetypeIndex];
+    const auto& componentIds = archetype->GetComponentIds();
+    if (numColumns != static_cast<int>(componentIds.size())) {
+      return false;
+    }
+    for (auto componentId : componentIds) {
+      int savedComponentId = -1;
+      unsigned int savedSize = 0;
+      reader.Read(savedComponentId);
+      reader.Read(savedSize);
+
+      const auto& typeInfo = IComponent::GetTypeInfo(componentId);
+      if (savedComponentId != componentId || savedSize != typeInfo.size ||
+          !typeInfo.read) {
+        return false;
+      }
+    }
+
+    int numRows = 0;
+    reader.ReadCount(numRows, sizeof(int));
+    std::vector<int> entityIds(numRows);
+    reader.Read(entityIds.data(), numRows * sizeof(int));
+    if (reader.Failed()) {
+      return false;
+    }
+
+    // Claim the locations first, so that a duplicate id is caught before
+    // any row is added
+    for (auto entityId : entityIds) {
+      if (entityId < 0 || entityId >= numEntities ||
+          (entityId < static_cast<int>(entityLocations.size()) && entityLocations[entityId].archetype != -1)) {
+        return false;
+      }
+      GrowToFit(entityLocations, entityId);
+      entityLocations[entityId].archetype = archetypeIndex;
+    }
+    for (auto entityId : entityIds) {
+      entityLocations[entityId].row = archetype->AddRow(entityId);
+    }
+
+    // Every component is constructed from here on, even if the reader fails
+    for (unsigned int column = 0; column < componentIds.size(); column++) {
+      const auto& typeInfo = IComponent::GetTypeInfo(componentIds[column]);
+
+      if (typeInfo.savedAsBytes) {
+        for (int chunk = 0; chunk < archetype->GetNumChunks(); chunk++) {
+          reader.Read(archetype->GetColumnData(chunk, column), archetype->GetChunkSize(chunk) * typeInfo.size);
+        }
+      } else {
+        for (int row = 0; row < numRows; row++) {
+          typeInfo.read(reader, archetype->GetComponent(row, column));
+        }
+      }
+
+      std::fill(archetype->GetAddedTicks(column), archetype->GetAddedTicks(column) + numRows, tick);
+      std::fill(archetype->GetChangedTicks(column), archetype->GetChangedTicks(column) + numRows, tick);
+    }
+  }
+
+  return !reader.Failed();
+}
+
+void* CommandBuffer::Allocate(size_t size, size_t alignment) {
+  blockOffset = (blockOffset + alignment - 1) / alignment * alignment;
+
+  if (blockOffset + size > BLOCK_SIZE) {
+    if (size > BLOCK_SIZE) {
+      // Too big for a shared block, give it its own
+      blocks.push_back(std::make_unique<unsigned char[]>(size));
+      blockOffset = BLOCK_SIZE;
+      return blocks.back().get();
+    }
+
+    blocks.push_back(std::make_unique<unsigned char[]>(BLOCK_SIZE));
+    blockOffset = 0;
+  }
+
+  void* memory = blocks.back().get() + blockOffset;
+  blockOffset += size;
+
+  return memory;
+}
+
+int CommandBuffer::GetSortKey(Entity entity) const {
+  if (entity.GetId() < 0 && -entity.GetId() - 1 < static_cast<int>(createSortKeys.size())) {
+    return createSortKeys[-entity.GetId() - 1];
+  }
+  return entity.GetId();
+}
+
+Entity CommandBuffer::CreateEntity(Entity source) {
+  const int index = createSortKeys.size();
+  const Entity entity(-(index + 1));
+
+  // A source created by this buffer sorts like its own source
+  const int sortKey = GetSortKey(source);
+  createSortKeys.push_back(sortKey);
+  commands.push_back({COMMAND_CREATE, sortKey, jobKey, entity, nullptr, nullptr, nullptr});
+
+  return entity;
+}
+
+void CommandBuffer::KillEntity(Entity entity) {
+  commands.push_back({COMMAND_KILL, GetSortKey(entity), jobKey, entity, nullptr, nullptr, nullptr});
+}
+
+void CommandBuffer::Clear() {
+  for (auto& command : commands) {
+    if (command.component) {
+      command.destroy(command.component);
+    }
+  }
+
+  commands.clear();
+  createSortKeys.clear();
+  blocks.clear();
+  blockOffset = BLOCK_SIZE;
+  jobKey = 0;
+}
+
 Entity Registry::CreateEntity() {
   int entityId;
 
@@ -34,49 +532,294 @@ Entity Registry::CreateEntity() {
     // If there are no freeIds to be reused
     entityId = numEntities++;
 
-    if (entityId >= static_cast<int>(entityComponentSignatures.size())) {
-      entityComponentSignatures.resize(entityId + 1);
-    }
+    GrowToFit(entityComponentSignatures, entityId);
+    GrowToFit(entityGenerations, entityId, 0u);
   } else {
     // Reuse an id from the list of previously removed entities 
     entityId = freeIds.front();
     freeIds.pop_front();
   }
 
-  Entity entity(entityId);
-  entity.registry = this;
-  entitiesToBeAdded.insert(entity);
+  Entity entity(entityId, entityGenerations[entityId]);
+  entitiesToBeAdded.push_back(entity);
 
   // Logger::Log("Entity created with id = " + std::to_string(entityId));
 
   return entity;
 }
 
-void Registry::KillEntity(Entity entity) { entitiesToBeKilled.insert(entity); }
+std::vector<Entity> Registry::CreateEntities(int count) {
+  if (count <= 0) {
+    Logger::Err("Tried to create " + std::to_string(count) + " entities");
+    return {};
+  }
+
+  std::vector<Entity> entities;
+  entities.reserve(count);
+
+  // Reuse the free ids first, then hand out a contiguous range of new ones
+  while (count > 0 && !freeIds.empty()) {
+    entities.push_back(CreateEntity());
+    count--;
+  }
+
+  if (count > 0) {
+    const int firstId = numEntities;
+    numEntities += count;
+    GrowToFit(entityComponentSignatures, numEntities - 1);
+    GrowToFit(entityGenerations, numEntities - 1, 0u);
+
+    for (int entityId = firstId; entityId < numEntities; entityId++) {
+      Entity entity(entityId, entityGenerations[entityId]);
+      entitiesToBeAdded.push_back(entity);
+      entities.push_back(entity);
+    }
+  }
+
+  return entities;
+}
+
+std::vector<Entity> Registry::Instantiate(Entity prefab, int count) {
+  if (count <= 0) {
+    Logger::Err("Tried to instantiate " + std::to_string(count) + " copies of entity id = " +
+                std::to_string(prefab.GetId()));
+    return {};
+  }
+
+  if (!Valid(prefab)) {
+    Logger::Err("Tried to instantiate a dead entity id = " + std::to_string(prefab.GetId()));
+    return {};
+  }
+
+  const Signature signature = entityComponentSignatures[prefab.GetId()];
+
+  // Tags have no storage, every stored component must be copyable
+  for (unsigned int componentId = 0; componentId < MAX_COMPONENTS; componentId++) {
+    const bool isStored = storageType == STORAGE_ARCHETYPE
+        ? signature.test(componentId) && IComponent::GetTypeInfo(componentId).size > 0
+        : signature.test(componentId) && componentId < componentPools.size() && componentPools[componentId];
+
+    if (isStored && !IComponent::GetTypeInfo(componentId).copyConstruct) {
+      Logger::Err("Tried to instantiate an entity with a component that cannot be copied, id = " +
+                  std::to_string(componentId));
+      return {};
+    }
+  }
+
+  std::vector<Entity> entities = CreateEntities(count);
+  std::vector<int> entityIds;
+  entityIds.reserve(entities.size());
+  for (auto entity : entities) {
+    entityIds.push_back(entity.GetId());
+    entityComponentSignatures[entity.GetId()] = signature;
+  }
+
+  if (storageType == STORAGE_ARCHETYPE) {
+    archetypeStorage.CloneEntity(prefab.GetId(), entityIds, changeTick);
+  } else {
+    for (unsigned int componentId = 0; componentId < componentPools.size(); componentId++) {
+      if (signature.test(componentId) && componentPools[componentId]) {
+        componentPools[componentId]->Clone(prefab.GetId(), entityIds, changeTick);
+      }
+    }
+
+    for (auto& group : groups) {
+      if ((group.second->GetSignature() & signature) == group.second->GetSignature()) {
+        for (auto entityId : entityIds) {
+          group.second->OnComponentAdded(entityId);
+        }
+      }
+    }
+  }
+
+  currentFrameStats.componentsAdded += entities.size() * signature.count();
+  return entities;
+}
+
+void Registry::ReserveEntities(int n) {
+  entityCapacity = std::max(entityCapacity, n);
+  entityComponentSignatures.reserve(n);
+  entityGenerations.reserve(n);
+  archetypeStorage.ReserveEntities(n);
+
+  for (auto& pool : componentPools) {
+    if (pool) {
+      pool->ReserveEntityIds(n);
+    }
+  }
+}
+
+void Registry::KillEntity(Entity entity) {
+  if (!Valid(entity)) {
+    return;
+  }
+
+  GrowToFit(entityIsToBeKilled, entity.GetId());
+  if (entityIsToBeKilled[entity.GetId()]) {
+    return;
+  }
+
+  entityIsToBeKilled[entity.GetId()] = true;
+  entitiesToBeKilled.push_back(entity);
+}
+
+void Registry::CreateCommandBuffers(int numThreads) {
+  while (static_cast<int>(commandBuffers.size()) < numThreads) {
+    commandBuffers.push_back(std::make_unique<CommandBuffer>());
+  }
+}
+
+void Registry::ReplayCommandBuffers() {
+  struct RecordedCommand {
+    int sortKey;
+    unsigned long long jobKey;
+    int buffer;
+    int command;
+
+    bool operator<(const RecordedCommand& other) const {
+      return std::tie(sortKey, jobKey, buffer, command) <
+             std::tie(other.sortKey, other.jobKey, other.buffer, other.command);
+    }
+  };
+
+  // Order the commands by the entity they apply to, then by the job that
+  // recorded them, so the result does not depend on which thread ran which
+  // job. The commands of a job keep the order they were recorded in.
+  std::vector<RecordedCommand> recordedCommands;
+  std::vector<std::vector<Entity>> createdEntities(commandBuffers.size());
+  for (unsigned int buffer = 0; buffer < commandBuffers.size(); buffer++) {
+    const auto& commands = commandBuffers[buffer]->commands;
+
+    for (unsigned int command = 0; command < commands.size(); command++) {
+      recordedCommands.push_back(
+          {commands[command].sortKey, commands[command].jobKey, static_cast<int>(buffer), static_cast<int>(command)});
+    }
+    createdEntities[buffer].resize(commandBuffers[buffer]->createSortKeys.size(), Entity(-1));
+  }
+
+  if (recordedCommands.empty()) {
+    return;
+  }
+  std::sort(recordedCommands.begin(), recordedCommands.end());
+
+  // Only the buffer index is left to order commands for the same entity
+  // recorded under the same job key on different threads
+  for (unsigned int i = 1; i < recordedCommands.size(); i++) {
+    const auto& previous = recordedCommands[i - 1];
+    const auto& current = recordedCommands[i];
+    if (current.sortKey == previous.sortKey && current.jobKey == previous.jobKey && current.buffer != previous.buffer) {
+      Logger::Err("Commands for entity id = " + std::to_string(current.sortKey) +
+                  " were recorded on several threads with the same job key, their order depends on the threads");
+      break;
+    }
+  }
+
+  for (const auto& recordedCommand : recordedCommands) {
+    auto& command = commandBuffers[recordedCommand.buffer]->commands[recordedCommand.command];
+    auto& created = createdEntities[recordedCommand.buffer];
+    const Entity entity = command.entity.GetId() < 0 && command.type != CommandBuffer::COMMAND_CREATE
+        ? created[-command.entity.GetId() - 1]
+        : command.entity;
+
+    switch (command.type) {
+      case CommandBuffer::COMMAND_CREATE:
+        created[-command.entity.GetId() - 1] = CreateEntity();
+        break;
+
+      case CommandBuffer::COMMAND_KILL:
+        KillEntity(entity);
+        break;
+
+      case CommandBuffer::COMMAND_ADD_COMPONENT:
+        command.apply(*this, entity, command.component);
+        command.component = nullptr;
+        break;
+
+      case CommandBuffer::COMMAND_REMOVE_COMPONENT:
+        command.apply(*this, entity, nullptr);
+        break;
+    }
+  }
+
+  for (auto& commandBuffer : commandBuffers) {
+    commandBuffer->Clear();
+  }
+  currentFrameStats.commandsReplayed = recordedCommands.size();
+}
+
+unsigned int Registry::GetAddedTick(int entityId, int componentId) const {
+  if (storageType == STORAGE_ARCHETYPE) {
+    return archetypeStorage.GetAddedTick(entityId, componentId);
+  }
+  return componentPools[componentId]->GetAddedTick(entityId);
+}
+
+unsigned int Registry::GetChangedTick(int entityId, int componentId) const {
+  if (storageType == STORAGE_ARCHETYPE) {
+    return archetypeStorage.GetChangedTick(entityId, componentId);
+  }
+  return componentPools[componentId]->GetChangedTick(entityId);
+}
 
 void Registry::Update() {
+  // Start a new frame, everything stamped from now on is newer than what
+  // the systems saw during the last one
+  AdvanceTick();
+
+  // Apply the structural changes recorded by worker threads
+  ReplayCommandBuffers();
+
   // Add the entities that are waiting to be created to the active systems
-  for (auto entity : entitiesToBeAdded) {
-    AddEntityToSystems(entity);
-  }
+  std::sort(entitiesToBeAdded.begin(), entitiesToBeAdded.end());
+  AddEntitiesToSystems(entitiesToBeAdded);
+  currentFrameStats.entitiesCreated = entitiesToBeAdded.size();
   entitiesToBeAdded.clear();
 
+  // Re-match the live entities that gained or lost components
+  currentFrameStats.signatureChanges = signatureChanges.size();
+  UpdateEntitiesWithChangedSignature();
+
   // Remove the entities that are waiting to be removed to the active systems
+  std::sort(entitiesToBeKilled.begin(), entitiesToBeKilled.end());
   for (auto entity : entitiesToBeKilled) {
     RemoveEntityFromSystems(entity);
     entityComponentSignatures[entity.GetId()].reset();
+    entityIsInSystems[entity.GetId()] = false;
+    entityIsToBeKilled[entity.GetId()] = false;
 
-    // Make the entity id available to be used later.
+    // Drop the components of the entity from the storage, leaving the
+    // groups first so that their prefixes stay packed
+    if (storageType == STORAGE_ARCHETYPE) {
+      archetypeStorage.RemoveEntity(entity.GetId());
+    }
+    for (auto& group : groups) {
+      group.second->OnComponentRemoved(entity.GetId());
+    }
+    for (auto& pool : componentPools) {
+      if (pool) {
+        pool->RemoveEntityFromPool(entity.GetId());
+      }
+    }
+
+    // Make the entity id available to be used later, invalidating the
+    // handles that still refer to it
+    entityGenerations[entity.GetId()]++;
     freeIds.push_back(entity.GetId());
   }
-
+  currentFrameStats.entitiesKilled = entitiesToBeKilled.size();
   entitiesToBeKilled.clear();
+
+  lastFrameStats = currentFrameStats;
+  currentFrameStats = RegistryStats();
 }
 
 void Registry::AddEntityToSystems(Entity entity) {
   const auto entityId = entity.GetId();
   const auto& entityComponentSignature = entityComponentSignatures[entityId];
 
+  GrowToFit(entityIsInSystems, entityId);
+  entityIsInSystems[entityId] = true;
+
   for (auto& system : systems) {
     const auto& systemComponentSignature =
         system.second->GetComponentSignature();
@@ -90,8 +833,491 @@ void Registry::AddEntityToSystems(Entity entity) {
   }
 }
 
+void Registry::AddEntitiesToSystems(const std::vector<Entity>& entities) {
+  for (auto entity : entities) {
+    GrowToFit(entityIsInSystems, entity.GetId());
+    entityIsInSystems[entity.GetId()] = true;
+  }
+
+  // One pass over the batch per system, instead of one pass over the systems
+  // per entity
+  for (auto& system : systems) {
+    const auto& systemComponentSignature =
+        system.second->GetComponentSignature();
+
+    for (auto entity : entities) {
+      const auto& entityComponentSignature =
+          entityComponentSignatures[entity.GetId()];
+
+      if ((entityComponentSignature & systemComponentSignature) ==
+          systemComponentSignature) {
+        system.second->AddEntityToSystem(entity);
+      }
+    }
+  }
+}
+
+void Registry::OnSignatureChange(Entity entity) {
+  const auto entityId = entity.GetId();
+
+  // Entities still waiting to be added are matched with their final
+  // signature when they are added
+  if (entityId >= static_cast<int>(entityIsInSystems.size()) || !entityIsInSystems[entityId]) {
+    return;
+  }
+
+  GrowToFit(entityHasSignatureChange, entityId);
+  if (entityHasSignatureChange[entityId]) {
+    return;
+  }
+
+  entityHasSignatureChange[entityId] = true;
+  signatureChanges.push_back({entity, entityComponentSignatures[entityId]});
+}
+
+void Registry::UpdateEntitiesWithChangedSignature() {
+  for (auto& system : systems) {
+    const auto& systemComponentSignature =
+        system.second->GetComponentSignature();
+
+    for (const auto& change : signatureChanges) {
+      const auto& entityComponentSignature =
+          entityComponentSignatures[change.entity.GetId()];
+
+      // Only the systems that require one of the components that were added
+      // or removed can be affected
+      if ((systemComponentSignature & (change.previousSignature ^ entityComponentSignature)).none()) {
+        continue;
+      }
+
+      if ((entityComponentSignature & systemComponentSignature) ==
+          systemComponentSignature) {
+        system.second->AddEntityToSystem(change.entity);
+      } else {
+        system.second->RemoveEntityFromSystem(change.entity);
+      }
+    }
+  }
+
+  for (const auto& change : signatureChanges) {
+    entityHasSignatureChange[change.entity.GetId()] = false;
+  }
+  signatureChanges.clear();
+}
+
 void Registry::RemoveEntityFromSystems(Entity entity) {
-  for (auto system : systems) {
+  for (auto& system : systems) {
     system.second->RemoveEntityFromSystem(entity);
   }
 }
+
+void Registry::Clear() {
+  for (auto& commandBuffer : commandBuffers) {
+    commandBuffer->Clear();
+  }
+  for (auto& pool : componentPools) {
+    if (pool) {
+      pool->Clear();
+    }
+  }
+  archetypeStorage.Clear();
+  for (auto& group : groups) {
+    group.second->Rebuild();
+  }
+  for (auto& system : systems) {
+    system.second->SetSystemEntities({});
+  }
+
+  numEntities = 0;
+  entityGenerations.clear();
+  entityComponentSignatures.clear();
+  entitiesToBeAdded.clear();
+  entitiesToBeKilled.clear();
+  entityIsToBeKilled.clear();
+  signatureChanges.clear();
+  entityHasSignatureChange.clear();
+  entityIsInSystems.clear();
+  freeIds.clear();
+}
+
+bool Registry::CanSnapshot() const {
+  for (const auto& commandBuffer : commandBuffers) {
+    if (!commandBuffer->IsEmpty()) {
+      Logger::Err("Tried to take a snapshot with commands waiting to be replayed");
+      return false;
+    }
+  }
+
+  // Every stored component must be saveable
+  Signature storedComponents;
+  if (storageType == STORAGE_ARCHETYPE) {
+    for (const auto& archetype : archetypeStorage.GetArchetypes()) {
+      for (auto componentId : archetype->GetComponentIds()) {
+        storedComponents.set(componentId, storedComponents.test(componentId) || archetype->GetNumRows() > 0);
+      }
+    }
+  } else {
+    for (unsigned int componentId = 0; componentId < componentPools.size(); componentId++) {
+      storedComponents.set(componentId, componentPools[componentId] && componentPools[componentId]->GetSize() > 0);
+    }
+  }
+  for (unsigned int componentId = 0; componentId < MAX_COMPONENTS; componentId++) {
+    if (storedComponents.test(componentId) && !IComponent::GetTypeInfo(componentId).write) {
+      Logger::Err("Tried to take a snapshot with a component that cannot be saved, id = " +
+                  std::to_string(componentId));
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<unsigned char> Registry::Snapshot() const {
+  if (!CanSnapshot()) {
+    return {};
+  }
+
+  std::vector<unsigned char> snapshot;
+  SnapshotWriter writer(snapshot);
+  WriteSnapshot(writer);
+  return snapshot;
+}
+
+void Registry::WriteSnapshot(SnapshotWriter& writer) const {
+  writer.Write(SNAPSHOT_MAGIC);
+  writer.Write(SNAPSHOT_VERSION);
+  writer.Write(static_cast<int>(storageType));
+
+  // Entities
+  writer.Write(numEntities);
+  writer.Write(entityGenerations.data(), numEntities * sizeof(unsigned int));
+  writer.Write(entityComponentSignatures.data(), numEntities * sizeof(Signature));
+  for (int entityId = 0; entityId < numEntities; entityId++) {
+    const bool isInSystems = entityId < static_cast<int>(entityIsInSystems.size()) && entityIsInSystems[entityId];
+    writer.Write(static_cast<unsigned char>(isInSystems));
+  }
+
+  writer.Write(static_cast<int>(freeIds.size()));
+  for (auto entityId : freeIds) {
+    writer.Write(entityId);
+  }
+
+  // Structural changes waiting for the next Update
+  writer.Write(static_cast<int>(entitiesToBeAdded.size()));
+  writer.Write(entitiesToBeAdded.data(), entitiesToBeAdded.size() * sizeof(Entity));
+  writer.Write(static_cast<int>(entitiesToBeKilled.size()));
+  writer.Write(entitiesToBeKilled.data(), entitiesToBeKilled.size() * sizeof(Entity));
+  writer.Write(static_cast<int>(signatureChanges.size()));
+  for (const auto& change : signatureChanges) {
+    writer.Write(change.entity);
+    writer.Write(change.previousSignature);
+  }
+
+  // Components
+  if (storageType == STORAGE_ARCHETYPE) {
+    archetypeStorage.Write(writer);
+  } else {
+    int numPools = 0;
+    for (const auto& pool : componentPools) {
+      numPools += pool && pool->GetSize() > 0;
+    }
+    writer.Write(numPools);
+    for (unsigned int componentId = 0; componentId < componentPools.size(); componentId++) {
+      if (componentPools[componentId] && componentPools[componentId]->GetSize() > 0) {
+        writer.Write(static_cast<int>(componentId));
+        writer.Write(static_cast<unsigned int>(IComponent::GetTypeInfo(componentId).size));
+        componentPools[componentId]->Write(writer);
+      }
+    }
+  }
+
+  // Systems, in the order of their entities
+  writer.Write(static_cast<int>(systems.size()));
+  for (const auto& system : systems) {
+    const auto& entities = system.second->GetSystemEntities();
+    writer.Write(std::string(system.first.name()));
+    writer.Write(static_cast<int>(entities.size()));
+    writer.Write(entities.data(), entities.size() * sizeof(Entity));
+  }
+}
+
+bool Registry::Restore(const std::vector<unsigned char>& snapshot) {
+  SnapshotReader reader(snapshot.data(), snapshot.size());
+  return RestoreSnapshot(reader);
+}
+
+bool Registry::RestoreSnapshot(SnapshotReader& reader) {
+  Clear();
+
+  // Everything restored is newer than what the systems saw so far
+  AdvanceTick();
+
+  if (!ReadSnapshot(reader)) {
+    Logger::Err("Could not restore the registry snapshot");
+    Clear();
+    return false;
+  }
+  return true;
+}
+
+bool Registry::ReadSnapshot(SnapshotReader& reader) {
+  unsigned int magic = 0;
+  unsigned int version = 0;
+  int savedStorageType = -1;
+  reader.Read(magic);
+  reader.Read(version);
+  reader.Read(savedStorageType);
+
+  if (magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION) {
+    Logger::Err("Not a registry snapshot, or one of another version");
+    return false;
+  }
+  if (savedStorageType != static_cast<int>(storageType)) {
+    Logger::Err("The snapshot was taken by a registry with another storage type");
+    return false;
+  }
+
+  auto readEntity = [this, &reader](Entity& entity) {
+    return reader.Read(entity) && entity.GetId() >= 0 && entity.GetId() < numEntities;
+  };
+
+  // Entities
+  if (!reader.ReadCount(numEntities, sizeof(unsigned int) + sizeof(Signature) + 1)) {
+    return false;
+  }
+  entityGenerations.resize(numEntities);
+  reader.Read(entityGenerations.data(), numEntities * sizeof(unsigned int));
+  entityComponentSignatures.resize(numEntities);
+  reader.Read(entityComponentSignatures.data(), numEntities * sizeof(Signature));
+  entityIsInSystems.resize(numEntities);
+  for (int entityId = 0; entityId < numEntities; entityId++) {
+    unsigned char isInSystems = 0;
+    reader.Read(isInSystems);
+    entityIsInSystems[entityId] = isInSystems;
+  }
+
+  int numFreeIds = 0;
+  reader.ReadCount(numFreeIds, sizeof(int));
+  for (int i = 0; i < numFreeIds; i++) {
+    int entityId = -1;
+    reader.Read(entityId);
+    if (entityId < 0 || entityId >= numEntities) {
+      return false;
+    }
+    freeIds.push_back(entityId);
+  }
+
+  // Structural changes waiting for the next Update
+  int numToBeAdded = 0;
+  reader.ReadCount(numToBeAdded, sizeof(Entity));
+  for (int i = 0; i < numToBeAdded; i++) {
+    Entity entity(-1);
+    if (!readEntity(entity)) {
+      return false;
+    }
+    entitiesToBeAdded.push_back(entity);
+  }
+
+  int numToBeKilled = 0;
+  reader.ReadCount(numToBeKilled, sizeof(Entity));
+  for (int i = 0; i < numToBeKilled; i++) {
+    Entity entity(-1);
+    if (!readEntity(entity)) {
+      return false;
+    }
+    GrowToFit(entityIsToBeKilled, entity.GetId());
+    entityIsToBeKilled[entity.GetId()] = true;
+    entitiesToBeKilled.push_back(entity);
+  }
+
+  int numSignatureChanges = 0;
+  reader.ReadCount(numSignatureChanges, sizeof(Entity) + sizeof(Signature));
+  for (int i = 0; i < numSignatureChanges; i++) {
+    Entity entity(-1);
+    Signature previousSignature;
+    if (!readEntity(entity) || !reader.Read(previousSignature)) {
+      return false;
+    }
+    GrowToFit(entityHasSignatureChange, entity.GetId());
+    entityHasSignatureChange[entity.GetId()] = true;
+    signatureChanges.push_back({entity, previousSignature});
+  }
+
+  // Components
+  if (storageType == STORAGE_ARCHETYPE) {
+    if (!archetypeStorage.Read(reader, numEntities, changeTick)) {
+      return false;
+    }
+  } else {
+    int numPools = 0;
+    reader.ReadCount(numPools, 2 * sizeof(int));
+    for (int i = 0; i < numPools; i++) {
+      int componentId = -1;
+      unsigned int size = 0;
+      reader.Read(componentId);
+      reader.Read(size);
+
+      // Runtime components must have been registered, with the same id, by
+      // the time the snapshot is restored
+      if (componentId < 0 || componentId >= static_cast<int>(MAX_COMPONENTS) ||
+          IComponent::GetTypeInfo(componentId).size != size || size == 0 ||
+          !IComponent::GetTypeInfo(componentId).read) {
+        Logger::Err("The snapshot has a component the registry does not know, id = " +
+                    std::to_string(componentId));
+        return false;
+      }
+
+      GrowToFit(componentPools, componentId);
+      if (!componentPools[componentId]) {
+        componentPools[componentId] = IComponent::GetTypeInfo(componentId).createPool();
+        componentPools[componentId]->ReserveEntityIds(entityCapacity);
+      }
+      if (!componentPools[componentId]->Read(reader, numEntities, changeTick)) {
+        return false;
+      }
+    }
+
+    for (auto& group : groups) {
+      group.second->Rebuild();
+    }
+  }
+
+  // Systems
+  int numSystems = 0;
+  reader.ReadCount(numSystems, sizeof(unsigned int) + sizeof(int));
+  if (numSystems != static_cast<int>(systems.size())) {
+    Logger::Err("The snapshot was taken by a registry with other systems");
+    return false;
+  }
+  for (int i = 0; i < numSystems; i++) {
+    std::string name;
+    int numSystemEntities = 0;
+    reader.Read(name);
+    reader.ReadCount(numSystemEntities, sizeof(Entity));
+
+    auto system = std::find_if(systems.begin(), systems.end(),
+                               [&name](const auto& system) { return name == system.first.name(); });
+    if (system == systems.end()) {
+      Logger::Err("The snapshot has a system the registry does not have: " + name);
+      return false;
+    }
+
+    std::vector<Entity> entities(numSystemEntities, Entity(-1));
+    reader.Read(entities.data(), entities.size() * sizeof(Entity));
+    for (auto entity : entities) {
+      if (entity.GetId() < 0 || entity.GetId() >= numEntities) {
+        return false;
+      }
+    }
+    system->second->SetSystemEntities(entities);
+  }
+
+  return !reader.Failed() && reader.GetRemaining() == 0;
+}
+
+bool Registry::SaveWorld(const std::string& path) const {
+  if (!CanSnapshot()) {
+    return false;
+  }
+
+  std::vector<unsigned char> snapshot;
+  std::vector<unsigned char> sections;
+  SnapshotWriter writer(snapshot, &sections);
+  WriteSnapshot(writer);
+
+  WorldFileHeader header;
+  header.magic = WORLD_FILE_MAGIC;
+  header.version = WORLD_FILE_VERSION;
+  header.snapshotOffset = sizeof(WorldFileHeader);
+  header.snapshotSize = snapshot.size();
+  header.sectionsOffset = (header.snapshotOffset + header.snapshotSize + SNAPSHOT_SECTION_ALIGNMENT - 1) /
+                          SNAPSHOT_SECTION_ALIGNMENT * SNAPSHOT_SECTION_ALIGNMENT;
+  header.sectionsSize = sections.size();
+  const std::vector<char> padding(header.sectionsOffset - header.snapshotOffset - header.snapshotSize, 0);
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(snapshot.data()), snapshot.size());
+  file.write(padding.data(), padding.size());
+  file.write(reinterpret_cast<const char*>(sections.data()), sections.size());
+  file.close();
+
+  if (!file) {
+    Logger::Err("Could not write the world file " + path);
+    return false;
+  }
+  return true;
+}
+
+// Maps the whole file copy-on-write, or reads it into memory where mmap is
+// not available. Returns nullptr if the file cannot be read.
+static std::shared_ptr<void> MapFile(const std::string& path, size_t& size) {
+#if defined(__unix__) || defined(__APPLE__)
+  const int file = open(path.c_str(), O_RDONLY);
+  if (file == -1) {
+    return nullptr;
+  }
+
+  struct stat status;
+  if (fstat(file, &status) != 0 || status.st_size == 0) {
+    close(file);
+    return nullptr;
+  }
+  size = status.st_size;
+
+  // Private and writable: the pages the pools write to are copied, the file
+  // itself is never modified
+  void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+  close(file);
+  if (address == MAP_FAILED) {
+    return nullptr;
+  }
+
+  const size_t mappedSize = size;
+  return std::shared_ptr<void>(address, [mappedSize](void* address) { munmap(address, mappedSize); });
+#else
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) {
+    return nullptr;
+  }
+  size = file.tellg();
+  file.seekg(0);
+
+  std::shared_ptr<unsigned char> bytes(new unsigned char[size], std::default_delete<unsigned char[]>());
+  if (!file.read(reinterpret_cast<char*>(bytes.get()), size)) {
+    return nullptr;
+  }
+  return bytes;
+#endif
+}
+
+bool Registry::LoadWorld(const std::string& path) {
+  size_t size = 0;
+  std::shared_ptr<void> file = MapFile(path, size);
+  if (!file) {
+    Logger::Err("Could not read the world file " + path);
+    return false;
+  }
+
+  WorldFileHeader header;
+  auto* bytes = static_cast<unsigned char*>(file.get());
+  if (size < sizeof(WorldFileHeader)) {
+    Logger::Err("Not a world file: " + path);
+    return false;
+  }
+  std::memcpy(&header, bytes, sizeof(WorldFileHeader));
+
+  if (header.magic != WORLD_FILE_MAGIC || header.version != WORLD_FILE_VERSION) {
+    Logger::Err("Not a world file, or one of another version: " + path);
+    return false;
+  }
+  if (header.snapshotOffset > size || size - header.snapshotOffset < header.snapshotSize ||
+      header.sectionsOffset > size || size - header.sectionsOffset < header.sectionsSize ||
+      header.sectionsOffset % SNAPSHOT_SECTION_ALIGNMENT != 0) {
+    Logger::Err("Truncated world file: " + path);
+    return false;
+  }
+
+  SnapshotReader reader(bytes + header.snapshotOffset, header.snapshotSize,
+                        bytes + header.sectionsOffset, header.sectionsSize, file);
+  return RestoreSnapshot(reader);
+}
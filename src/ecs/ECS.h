@@ -1,64 +1,478 @@
 #ifndef ECS_H
 #define ECS_H
 
+#include <algorithm>
+#include <atomic>
 #include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
-#include <set>
+#include <string>
+#include <tuple>
+#include <type_traits>
 #include <typeindex>
 #include <unordered_map>
 #include <vector>
 #include <deque>
 
 #include "../logger/Logger.h"
+#include "../jobs/JobSystem.h"
 
-const unsigned int MAX_COMPONENTS = 32;
-typedef std::bitset<MAX_COMPONENTS> Signature;
+// Number of component types a signature can hold. Build with
+// -DECS_MAX_COMPONENTS=128 (or 256) when the game needs more.
+#ifndef ECS_MAX_COMPONENTS
+#define ECS_MAX_COMPONENTS 64
+#endif
 
+template <std::size_t Width>
+using BasicSignature = std::bitset<Width>;
+
+const unsigned int MAX_COMPONENTS = ECS_MAX_COMPONENTS;
+static_assert(MAX_COMPONENTS == 32 || MAX_COMPONENTS == 64 ||
+                  MAX_COMPONENTS == 128 || MAX_COMPONENTS == 256,
+              "ECS_MAX_COMPONENTS must be 32, 64, 128 or 256");
+typedef BasicSignature<MAX_COMPONENTS> Signature;
+
+// Grows the vector so that `index` is valid, at least doubling its capacity
+// when it runs out so that growing it one index at a time stays amortized O(1)
+template <typename T>
+void GrowToFit(std::vector<T>& vector, int index, const T& value = T()) {
+  if (index < static_cast<int>(vector.size())) {
+    return;
+  }
+
+  if (index >= static_cast<int>(vector.capacity())) {
+    vector.reserve(std::max<size_t>(index + 1, vector.capacity() * 2));
+  }
+  vector.resize(index + 1, value);
+}
+
+// Sections of a world file start on page boundaries, so that a mapped file
+// can be used in place and copied on write one section at a time
+const size_t SNAPSHOT_SECTION_ALIGNMENT = 4096;
+
+// Appends plain bytes to the blob written by Registry::Snapshot. Given a
+// sections buffer, the bulk component data goes there instead, see
+// WriteSection.
+class SnapshotWriter {
+ private:
+  std::vector<unsigned char>& bytes;
+  std::vector<unsigned char>* sections;
+
+ public:
+  SnapshotWriter(std::vector<unsigned char>& bytes, std::vector<unsigned char>* sections = nullptr)
+      : bytes(bytes), sections(sections) {}
+
+  void Write(const void* data, size_t size) {
+    const auto* first = static_cast<const unsigned char*>(data);
+    bytes.insert(bytes.end(), first, first + size);
+  }
+
+  template <typename T>
+  void Write(const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be written as bytes");
+    Write(&value, sizeof(T));
+  }
+
+  void Write(const std::string& value) {
+    Write(static_cast<unsigned int>(value.size()));
+    Write(value.data(), value.size());
+  }
+
+  // Writes bytes that a storage may use in place once read back. With a
+  // sections buffer they are appended there, aligned, and only their offset
+  // is written to the blob.
+  void WriteSection(const void* data, size_t size) {
+    if (!sections) {
+      Write(data, size);
+      return;
+    }
+
+    const size_t offset = (sections->size() + SNAPSHOT_SECTION_ALIGNMENT - 1) /
+                          SNAPSHOT_SECTION_ALIGNMENT * SNAPSHOT_SECTION_ALIGNMENT;
+    Write(static_cast<unsigned long long>(offset));
+    sections->resize(offset);
+    const auto* first = static_cast<const unsigned char*>(data);
+    sections->insert(sections->end(), first, first + size);
+  }
+};
+
+// Reads back a blob written by SnapshotWriter. A read past the end of the
+// blob fails instead of overrunning it, and so does every read after it.
+class SnapshotReader {
+ private:
+  const unsigned char* position;
+  const unsigned char* end;
+  bool failed = false;
+  const unsigned char* sections = nullptr;
+  size_t sectionsSize = 0;
+  std::shared_ptr<void> sectionsOwner;
+
+ public:
+  SnapshotReader(const unsigned char* data, size_t size) : position(data), end(data + size) {}
+
+  // Reads a blob whose sections were written to a separate buffer, owned by
+  // sectionsOwner. Storages may keep using the section bytes in place, and
+  // write to them, for as long as they hold on to sectionsOwner.
+  SnapshotReader(const unsigned char* data, size_t size, unsigned char* sections, size_t sectionsSize,
+                 std::shared_ptr<void> sectionsOwner)
+      : position(data), end(data + size), sections(sections), sectionsSize(sectionsSize),
+        sectionsOwner(std::move(sectionsOwner)) {}
+
+  bool Failed() const { return failed; }
+  size_t GetRemaining() const { return end - position; }
+
+  // Owner of the section bytes when they can be used in place, or nullptr
+  // when they only live as long as the blob
+  const std::shared_ptr<void>& GetSectionsOwner() const { return sectionsOwner; }
+
+  // Bytes written by WriteSection, or nullptr on failure
+  unsigned char* ReadSection(size_t size) {
+    if (!sections) {
+      if (failed || GetRemaining() < size) {
+        failed = true;
+        return nullptr;
+      }
+      const unsigned char* section = position;
+      position += size;
+      return const_cast<unsigned char*>(section);
+    }
+
+    unsigned long long offset = 0;
+    if (!Read(offset) || offset > sectionsSize || sectionsSize - offset < size) {
+      failed = true;
+      return nullptr;
+    }
+    return const_cast<unsigned char*>(sections) + offset;
+  }
+
+  // Fills data with size bytes, or with zeros once the reader failed
+  bool Read(void* data, size_t size) {
+    if (size == 0) {
+      return !failed;
+    }
+    if (failed || GetRemaining() < size) {
+      failed = true;
+      std::memset(data, 0, size);
+      return false;
+    }
+
+    std::memcpy(data, position, size);
+    position += size;
+    return true;
+  }
+
+  template <typename T>
+  bool Read(T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be read as bytes");
+    return Read(&value, sizeof(T));
+  }
+
+  bool Read(std::string& value) {
+    unsigned int size = 0;
+    if (!Read(size) || GetRemaining() < size) {
+      failed = true;
+      return false;
+    }
+
+    value.assign(reinterpret_cast<const char*>(position), size);
+    position += size;
+    return true;
+  }
+
+  // Reads the number of elements that follow, each at least elementSize
+  // bytes long. Fails on counts the rest of the blob cannot hold, so that a
+  // corrupt blob cannot make the reader allocate gigabytes.
+  bool ReadCount(int& count, size_t elementSize) {
+    if (!Read(count) || count < 0 || GetRemaining() / std::max<size_t>(elementSize, 1) < static_cast<size_t>(count)) {
+      failed = true;
+      count = 0;
+      return false;
+    }
+    return true;
+  }
+};
+
+// Saves and restores the components that are not trivially copyable in
+// snapshots. Specialize it with
+//   static void Write(SnapshotWriter& writer, const T& component);
+//   static void Read(SnapshotReader& reader, void* destination);
+// where Read always constructs a component at destination, even when the
+// reader fails. Trivially copyable components are saved as raw bytes,
+// unless they specialize it too because their bytes only make sense in the
+// process that wrote them, like interned handles.
+template <typename T>
+struct ComponentSerializer {};
+
+template <typename T, typename = void>
+struct HasComponentSerializer : std::false_type {};
+
+template <typename T>
+struct HasComponentSerializer<T, std::void_t<decltype(&ComponentSerializer<T>::Write)>> : std::true_type {};
+
+// Whether the component can be saved in a snapshot
+template <typename T>
+struct IsSaveable
+    : std::integral_constant<bool, std::is_trivially_copyable<T>::value || HasComponentSerializer<T>::value> {};
+
+// Whether the component is saved as raw bytes
+template <typename T>
+struct IsSavedAsBytes
+    : std::integral_constant<bool, std::is_trivially_copyable<T>::value && !HasComponentSerializer<T>::value> {};
+
+template <typename T>
+void WriteComponent(SnapshotWriter& writer, const T& component) {
+  if constexpr (IsSavedAsBytes<T>::value) {
+    writer.Write(&component, sizeof(T));
+  } else {
+    ComponentSerializer<T>::Write(writer, component);
+  }
+}
+
+// Constructs a component read from the snapshot at destination
+template <typename T>
+void ReadComponent(SnapshotReader& reader, void* destination) {
+  if constexpr (IsSavedAsBytes<T>::value) {
+    reader.Read(destination, sizeof(T));
+  } else {
+    ComponentSerializer<T>::Read(reader, destination);
+  }
+}
+
+class IPool;
+
+template <typename T>
+class Pool;
+
+// Empty component types are tags: they only occupy their bit in the
+// signature of an entity and are never stored
+template <typename T>
+struct IsTag : std::is_empty<T> {};
+
+// Type-erased description of a component type, used by the storages that
+// only know a component by its id. Tags have a size of 0.
+struct ComponentTypeInfo {
+  size_t size;
+  size_t alignment;
+  // Copies of trivially copyable components are plain memcpy
+  bool triviallyCopyable;
+  // Saved in snapshots as raw bytes, see ComponentSerializer
+  bool savedAsBytes;
+  void (*moveConstruct)(void* destination, void* source);
+  // nullptr when the component cannot be copied
+  void (*copyConstruct)(void* destination, const void* source);
+  void (*destroy)(void* component);
+  // nullptr when the component cannot be saved in a snapshot
+  void (*write)(SnapshotWriter& writer, const void* component);
+  void (*read)(SnapshotReader& reader, void* destination);
+  // Creates an empty pool of the component, nullptr for tags
+  std::shared_ptr<IPool> (*createPool)();
+};
+
+// Type list of components
+template <typename... TComponents>
+struct ComponentList {};
+
+// Index of T in a ComponentList, or -1 if it is not in the list
+template <typename T, typename TList>
+struct ComponentListIndex;
+
+template <typename T>
+struct ComponentListIndex<T, ComponentList<>> {
+  static constexpr int value = -1;
+};
+
+template <typename T, typename THead, typename... TTail>
+struct ComponentListIndex<T, ComponentList<THead, TTail...>> {
+ private:
+  static constexpr int tailIndex = ComponentListIndex<T, ComponentList<TTail...>>::value;
+
+ public:
+  static constexpr int value = std::is_same<T, THead>::value ? 0 : (tailIndex == -1 ? -1 : tailIndex + 1);
+};
+
+template <typename TList>
+struct ComponentListSize;
+
+template <typename... TComponents>
+struct ComponentListSize<ComponentList<TComponents...>> {
+  static constexpr int value = sizeof...(TComponents);
+};
+
+// Component types whose ids are known at compile time: their index in List.
+// Opt in with ECS_STATIC_COMPONENTS, which must be seen before any use of
+// Component<T>: a translation unit that misses it gives the listed types
+// runtime ids, silently. Have every header that defines a listed type
+// include the header with the list first. Every other type gets an id at
+// runtime.
+template <typename TTag = void>
+struct StaticComponents {
+  using List = ComponentList<>;
+};
+
+#define ECS_STATIC_COMPONENTS(...)                                        \
+  template <>                                                             \
+  struct StaticComponents<void> {                                         \
+    using List = ComponentList<__VA_ARGS__>;                              \
+  };                                                                      \
+  static_assert(ComponentListSize<StaticComponents<>::List>::value <=     \
+                    static_cast<int>(MAX_COMPONENTS),                     \
+                "Too many static components for ECS_MAX_COMPONENTS");     \
+  static const bool staticComponentsRegistered =                         \
+      RegisterComponentList(StaticComponents<>::List())
+
+// Always void, but dependent on T so that StaticComponents is looked up when
+// Component<T> is instantiated instead of when it is defined
+template <typename T>
+struct DependentVoid {
+  using type = void;
+};
+
+// Component ids and type infos are shared by every registry. Registration
+// is thread-safe, so that registries living on different threads can meet a
+// component type for the first time at once: runtime ids come from an atomic
+// counter and the type infos never move, every id owning its own entry.
 struct IComponent {
+ public:
+  static const ComponentTypeInfo& GetTypeInfo(int componentId) {
+    return typeInfos[componentId];
+  }
+
  protected:
-  static int nextId;
+  static std::atomic<int> nextId;
+  static ComponentTypeInfo typeInfos[MAX_COMPONENTS];
 };
 
-// Used to assign a unique id to a component type
+// Used to assign a unique id to a component type. Static components get
+// their index in StaticComponents<>::List, which folds to a constant in the
+// hot loops. The others get runtime ids counting down from MAX_COMPONENTS - 1.
 template <typename T>
 class Component : public IComponent {
  public:
+  using StaticList = typename StaticComponents<typename DependentVoid<T>::type>::List;
+  static constexpr int staticId = ComponentListIndex<T, StaticList>::value;
+
   // Returns the unique id of Component<T>
   static int GetId() {
-    static auto id = nextId++;
+    if constexpr (staticId != -1) {
+      return staticId;
+    } else {
+      static auto id = RegisterRuntimeId();
+      return id;
+    }
+  }
+
+  // Makes the type info of T available through IComponent::GetTypeInfo.
+  // Runtime ids are registered by GetId, static ids need this call before
+  // T is stored by id.
+  static void RegisterTypeInfo() {
+    if constexpr (staticId != -1) {
+      static auto id = Register(staticId);
+      (void)id;
+    }
+  }
+
+ private:
+  static int RegisterRuntimeId() {
+    const int id = MAX_COMPONENTS - 1 - nextId++;
+
+    // Past this point the id would collide with a static id or index out of
+    // the type infos, and every signature bit of the type would be wrong
+    if (id < ComponentListSize<StaticList>::value) {
+      Logger::Err("Too many component types for ECS_MAX_COMPONENTS");
+      std::abort();
+    }
+    return Register(id);
+  }
+
+  static int Register(int id) {
+    void (*copyConstruct)(void*, const void*) = nullptr;
+    if constexpr (std::is_copy_constructible<T>::value) {
+      copyConstruct = [](void* destination, const void* source) {
+        new (destination) T(*static_cast<const T*>(source));
+      };
+    }
+
+    void (*write)(SnapshotWriter&, const void*) = nullptr;
+    void (*read)(SnapshotReader&, void*) = nullptr;
+    if constexpr (IsSaveable<T>::value) {
+      write = [](SnapshotWriter& writer, const void* component) {
+        WriteComponent(writer, *static_cast<const T*>(component));
+      };
+      read = [](SnapshotReader& reader, void* destination) { ReadComponent<T>(reader, destination); };
+    }
+
+    std::shared_ptr<IPool> (*createPool)() = nullptr;
+    if constexpr (!IsTag<T>::value) {
+      createPool = []() -> std::shared_ptr<IPool> { return std::make_shared<Pool<T>>(); };
+    }
+
+    typeInfos[id] = {
+        IsTag<T>::value ? 0 : sizeof(T), alignof(T), std::is_trivially_copyable<T>::value, IsSavedAsBytes<T>::value,
+        [](void* destination, void* source) {
+          new (destination) T(std::move(*static_cast<T*>(source)));
+        },
+        copyConstruct,
+        [](void* component) { static_cast<T*>(component)->~T(); },
+        write, read, createPool};
     return id;
   }
 };
 
+// Registers the type infos of every component of the list. Used by
+// ECS_STATIC_COMPONENTS so that the static components are known by id, to
+// restore snapshots, before any of them is used.
+template <typename... TComponents>
+bool RegisterComponentList(ComponentList<TComponents...>) {
+  (Component<TComponents>::RegisterTypeInfo(), ...);
+  return true;
+}
+
+// Handle to an entity: the index of its slot in the registry plus the
+// generation of that slot. Killing an entity bumps the generation of its
+// slot, so handles kept around after the slot is reused are detected by
+// Registry::Valid instead of silently reading another entity's components.
 class Entity {
  private:
   int id;
+  unsigned int generation;
 
  public:
-  Entity(int id) : id(id){};
+  Entity(int id, unsigned int generation = 0) : id(id), generation(generation){};
   Entity(const Entity& entity) = default;
-  void Kill();
-  int GetId() const;
+  int GetId() const { return id; }
+  unsigned int GetGeneration() const { return generation; }
 
   Entity& operator=(const Entity& other) = default;
-  bool operator==(const Entity& other) const { return id == other.id; }
-  bool operator!=(const Entity& other) const { return id != other.id; }
-  bool operator>(const Entity& other) const { return id > other.id; }
-  bool operator<(const Entity& other) const { return id < other.id; }
+  bool operator==(const Entity& other) const { return id == other.id && generation == other.generation; }
+  bool operator!=(const Entity& other) const { return !(*this == other); }
+  bool operator>(const Entity& other) const { return other < *this; }
+  bool operator<(const Entity& other) const {
+    return id < other.id || (id == other.id && generation < other.generation);
+  }
+};
 
-  template <typename TComponent, typename... TArgs> void AddComponent(TArgs&&... args);
-  template <typename TComponent> void RemoveComponent();
-  template <typename TComponent> bool HasComponent() const;
-  template <typename TComponent> TComponent& GetComponent() const;
 
-  class Registry *registry;
+// How a system uses a component, so that systems that do not conflict can
+// run at the same time
+enum ComponentAccess {
+  ACCESS_READ,
+  ACCESS_WRITE
 };
 
-
 class System {
  private:
   Signature componentSignature;
+  Signature readSignature;
+  Signature writeSignature;
+  // Dense set of the entities of the system, entityIdToIndex maps an entity
+  // id to its position in `entities` (or -1) so membership changes are O(1)
   std::vector<Entity> entities;
+  std::vector<int> entityIdToIndex;
+  // Bumped by every change of the entities of the system
+  unsigned int membershipVersion = 0;
 
  public:
   System() = default;
@@ -66,84 +480,1006 @@ class System {
 
   void AddEntityToSystem(Entity entity);
   void RemoveEntityFromSystem(Entity entity);
-  std::vector<Entity> GetSystemEntities() const;
+  bool HasEntity(Entity entity) const;
+  const std::vector<Entity>& GetSystemEntities() const;
+  // Replaces the entities of the system, in the given order
+  void SetSystemEntities(const std::vector<Entity>& entities);
+  // Changes whenever an entity is added or removed, so that systems caching
+  // data about their entities know when to rebuild it
+  unsigned int GetMembershipVersion() const { return membershipVersion; }
   const Signature& GetComponentSignature() const;
+  const Signature& GetReadSignature() const { return readSignature; }
+  const Signature& GetWriteSignature() const { return writeSignature; }
+
+  // Whether one of the systems writes a component the other one uses
+  bool ConflictsWith(const System& other) const;
 
   // Define the component type T that entities must have to be
-  // considered by the system
+  // considered by the system, and how the system accesses it
+  template <typename TComponent>
+  void RequireComponent(ComponentAccess access = ACCESS_WRITE);
+
+  // Declare access to a component type the system uses without requiring it
   template <typename TComponent>
-  void RequireComponent();
+  void AccessComponent(ComponentAccess access);
 };
 
 template <typename TComponent>
-void System::RequireComponent() {
+void System::RequireComponent(ComponentAccess access) {
+  const auto componentId = Component<TComponent>::GetId();
+
+  componentSignature.set(componentId);
+  AccessComponent<TComponent>(access);
+}
+
+template <typename TComponent>
+void System::AccessComponent(ComponentAccess access) {
   const auto componentId = Component<TComponent>::GetId();
 
-  componentSignature.set(componentId);
+  if (access == ACCESS_WRITE) {
+    writeSignature.set(componentId);
+  } else {
+    readSignature.set(componentId);
+  }
+}
+
+class IPool {
+ public:
+  virtual ~IPool() {}
+  virtual void RemoveEntityFromPool(int entityId) = 0;
+  virtual bool HasEntity(int entityId) const = 0;
+  virtual int GetSize() const = 0;
+  virtual void ReserveEntityIds(int n) = 0;
+  virtual unsigned int GetAddedTick(int entityId) const = 0;
+  virtual unsigned int GetChangedTick(int entityId) const = 0;
+  // Gives every entity, none of which has the component yet, a copy of the
+  // component of sourceEntityId
+  virtual void Clone(int sourceEntityId, const std::vector<int>& entityIds, unsigned int tick) = 0;
+  virtual void Clear() = 0;
+  // Saves the components in slot order with the ids of their entities,
+  // without their ticks
+  virtual void Write(SnapshotWriter& writer) const = 0;
+  // Replaces the components with the ones saved by Write, stamping them as
+  // added at tick. Fails on entity ids outside [0, numEntities).
+  virtual bool Read(SnapshotReader& reader, int numEntities, unsigned int tick) = 0;
+};
+
+// Packed array of the components of a pool, a std::vector that can also
+// adopt memory it does not own, such as the pages of a mapped world file.
+// Adopted memory is used in place until the array first needs to grow or
+// shrink, then it is copied into the vector. Only trivially copyable
+// components are adopted, so that copy is a memcpy.
+template <typename T>
+class ComponentArray {
+ private:
+  std::vector<T> owned;
+  T* adopted = nullptr;
+  size_t adoptedSize = 0;
+  // Keeps the adopted memory alive
+  std::shared_ptr<void> adoptedOwner;
+
+  void Own() {
+    if constexpr (std::is_trivially_copyable<T>::value) {
+      if (adopted) {
+        owned.assign(adopted, adopted + adoptedSize);
+        adopted = nullptr;
+        adoptedOwner.reset();
+      }
+    }
+  }
+
+ public:
+  bool empty() const { return size() == 0; }
+  size_t size() const { return adopted ? adoptedSize : owned.size(); }
+  T* data() { return adopted ? adopted : owned.data(); }
+  const T* data() const { return adopted ? adopted : owned.data(); }
+  const T* begin() const { return data(); }
+  const T* end() const { return data() + size(); }
+  T& operator[](size_t index) { return data()[index]; }
+  const T& operator[](size_t index) const { return data()[index]; }
+
+  void reserve(size_t n) {
+    Own();
+    owned.reserve(n);
+  }
+
+  void clear() {
+    adopted = nullptr;
+    adoptedOwner.reset();
+    owned.clear();
+  }
+
+  void push_back(T object) {
+    Own();
+    owned.push_back(std::move(object));
+  }
+
+  // Moves every element of elements to the end
+  void MoveAppend(std::vector<T>& elements) {
+    Own();
+    owned.insert(owned.end(), std::make_move_iterator(elements.begin()), std::make_move_iterator(elements.end()));
+  }
+
+  void pop_back() {
+    if (adopted) {
+      adoptedSize--;
+      return;
+    }
+    owned.pop_back();
+  }
+
+  // Grows with copies of value
+  void resize(size_t n, const T& value) {
+    Own();
+    owned.resize(n, value);
+  }
+
+  // Uses the count components at elements in place, owner keeps them alive
+  void Adopt(T* elements, size_t count, std::shared_ptr<void> owner) {
+    static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable components can be adopted");
+    owned.clear();
+    owned.shrink_to_fit();
+    adopted = elements;
+    adoptedSize = count;
+    adoptedOwner = std::move(owner);
+  }
+
+  // Copies count components from bytes, which need not be aligned
+  void AssignBytes(const void* bytes, size_t count) {
+    static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable components are copied as bytes");
+    clear();
+    if constexpr (std::is_default_constructible<T>::value) {
+      owned.resize(count);
+      std::memcpy(owned.data(), bytes, count * sizeof(T));
+    } else {
+      owned.reserve(count);
+      for (size_t index = 0; index < count; index++) {
+        alignas(T) unsigned char component[sizeof(T)];
+        std::memcpy(component, static_cast<const unsigned char*>(bytes) + index * sizeof(T), sizeof(T));
+        owned.push_back(*reinterpret_cast<T*>(component));
+      }
+    }
+  }
+};
+
+// Sparse set of components of type T. The components are kept packed in
+// `data`, `entityIdToIndex` maps an entity id to its slot in `data` (or -1)
+// and `indexToEntityId` maps a slot back to the entity that owns it.
+// `addedTicks` and `changedTicks` hold, per slot, the registry tick at which
+// the component was added and last written.
+template <typename T>
+class Pool : public IPool {
+ private:
+  ComponentArray<T> data;
+  std::vector<int> entityIdToIndex;
+  std::vector<int> indexToEntityId;
+  std::vector<unsigned int> addedTicks;
+  std::vector<unsigned int> changedTicks;
+
+ public:
+  Pool(int capacity = 100) {
+    data.reserve(capacity);
+    indexToEntityId.reserve(capacity);
+    addedTicks.reserve(capacity);
+    changedTicks.reserve(capacity);
+  }
+
+  virtual ~Pool() = default;
+
+  bool isEmpty() const { return data.empty(); }
+
+  int GetSize() const override { return data.size(); }
+
+  // Preallocates room for n components
+  void Reserve(int n) {
+    data.reserve(n);
+    indexToEntityId.reserve(n);
+    addedTicks.reserve(n);
+    changedTicks.reserve(n);
+  }
+
+  // Preallocates the sparse map for entity ids up to n
+  void ReserveEntityIds(int n) override { entityIdToIndex.reserve(n); }
+
+  // Extends the sparse map to cover every entity id up to maxEntityId at
+  // once, before a batch of components is added
+  void GrowEntityIds(int maxEntityId) { GrowToFit(entityIdToIndex, maxEntityId, -1); }
+
+  void Clear() override {
+    data.clear();
+    entityIdToIndex.clear();
+    indexToEntityId.clear();
+    addedTicks.clear();
+    changedTicks.clear();
+  }
+
+  bool HasEntity(int entityId) const override {
+    return entityId < static_cast<int>(entityIdToIndex.size()) &&
+           entityIdToIndex[entityId] != -1;
+  }
+
+  // Adds or replaces the component of the entity, stamping it with tick
+  void Set(int entityId, T object, unsigned int tick = 0) {
+    if (HasEntity(entityId)) {
+      const int index = entityIdToIndex[entityId];
+      data[index] = std::move(object);
+      changedTicks[index] = tick;
+      return;
+    }
+
+    GrowToFit(entityIdToIndex, entityId, -1);
+    entityIdToIndex[entityId] = data.size();
+    indexToEntityId.push_back(entityId);
+    data.push_back(std::move(object));
+    addedTicks.push_back(tick);
+    changedTicks.push_back(tick);
+  }
+
+  // Adds the components of entities that have none yet, one bulk append per
+  // array. Returns false and changes nothing when an entity already has one
+  // or is repeated.
+  bool Append(const std::vector<Entity>& entities, std::vector<T>& components, unsigned int tick) {
+    const int firstIndex = data.size();
+    const int count = entities.size();
+
+    for (int i = 0; i < count; i++) {
+      const int entityId = entities[i].GetId();
+      GrowToFit(entityIdToIndex, entityId, -1);
+      if (entityIdToIndex[entityId] != -1) {
+        for (int j = 0; j < i; j++) {
+          entityIdToIndex[entities[j].GetId()] = -1;
+        }
+        return false;
+      }
+      entityIdToIndex[entityId] = firstIndex + i;
+    }
+
+    data.MoveAppend(components);
+    for (auto entity : entities) {
+      indexToEntityId.push_back(entity.GetId());
+    }
+    addedTicks.insert(addedTicks.end(), count, tick);
+    changedTicks.insert(changedTicks.end(), count, tick);
+    return true;
+  }
+
+  // Removes the component of the given entity by moving the last component
+  // into its slot, keeping the data packed
+  void Remove(int entityId) {
+    const int indexOfRemoved = entityIdToIndex[entityId];
+    const int indexOfLast = data.size() - 1;
+
+    if (indexOfRemoved != indexOfLast) {
+      const int entityIdOfLast = indexToEntityId[indexOfLast];
+      data[indexOfRemoved] = std::move(data[indexOfLast]);
+      indexToEntityId[indexOfRemoved] = entityIdOfLast;
+      addedTicks[indexOfRemoved] = addedTicks[indexOfLast];
+      changedTicks[indexOfRemoved] = changedTicks[indexOfLast];
+      entityIdToIndex[entityIdOfLast] = indexOfRemoved;
+    }
+
+    data.pop_back();
+    indexToEntityId.pop_back();
+    addedTicks.pop_back();
+    changedTicks.pop_back();
+    entityIdToIndex[entityId] = -1;
+  }
+
+  void RemoveEntityFromPool(int entityId) override {
+    if (HasEntity(entityId)) {
+      Remove(entityId);
+    }
+  }
+
+  void Clone(int sourceEntityId, const std::vector<int>& entityIds, unsigned int tick) override {
+    if constexpr (std::is_copy_constructible<T>::value) {
+      // Copied first, the source lives in data which is about to grow
+      const T source = Get(sourceEntityId);
+      const int firstIndex = data.size();
+      const int count = entityIds.size();
+
+      // One bulk append per array, a plain fill for trivially copyable T
+      data.resize(firstIndex + count, source);
+      indexToEntityId.insert(indexToEntityId.end(), entityIds.begin(), entityIds.end());
+      addedTicks.insert(addedTicks.end(), count, tick);
+      changedTicks.insert(changedTicks.end(), count, tick);
+
+      for (int i = 0; i < count; i++) {
+        GrowToFit(entityIdToIndex, entityIds[i], -1);
+        entityIdToIndex[entityIds[i]] = firstIndex + i;
+      }
+    } else {
+      Logger::Err("Tried to clone a component that cannot be copied");
+    }
+  }
+
+  void Write(SnapshotWriter& writer) const override {
+    if constexpr (IsSaveable<T>::value) {
+      writer.Write(static_cast<int>(data.size()));
+      writer.Write(indexToEntityId.data(), indexToEntityId.size() * sizeof(int));
+
+      if constexpr (IsSavedAsBytes<T>::value) {
+        writer.WriteSection(data.data(), data.size() * sizeof(T));
+      } else {
+        for (const auto& component : data) {
+          WriteComponent(writer, component);
+        }
+      }
+    } else {
+      Logger::Err("Tried to save a component that cannot be saved");
+    }
+  }
+
+  bool Read(SnapshotReader& reader, int numEntities, unsigned int tick) override {
+    Clear();
+
+    int size = 0;
+    if (!reader.ReadCount(size, sizeof(int))) {
+      return false;
+    }
+    indexToEntityId.resize(size);
+    reader.Read(indexToEntityId.data(), size * sizeof(int));
+
+    entityIdToIndex.assign(numEntities, -1);
+    for (int index = 0; index < size; index++) {
+      const int entityId = indexToEntityId[index];
+      if (entityId < 0 || entityId >= numEntities || entityIdToIndex[entityId] != -1) {
+        Clear();
+        return false;
+      }
+      entityIdToIndex[entityId] = index;
+    }
+
+    if constexpr (IsSavedAsBytes<T>::value) {
+      unsigned char* bytes = reader.ReadSection(size * sizeof(T));
+      if (!bytes) {
+        Clear();
+        return false;
+      }
+
+      if (reader.GetSectionsOwner() && reinterpret_cast<std::uintptr_t>(bytes) % alignof(T) == 0) {
+        // Used in place, nothing is copied until the pool is modified
+        data.Adopt(reinterpret_cast<T*>(bytes), size, reader.GetSectionsOwner());
+      } else {
+        // One copy for the whole pool
+        data.AssignBytes(bytes, size);
+      }
+    } else if constexpr (IsSaveable<T>::value) {
+      data.reserve(size);
+      for (int index = 0; index < size; index++) {
+        alignas(T) unsigned char bytes[sizeof(T)];
+        ReadComponent<T>(reader, bytes);
+        T* component = reinterpret_cast<T*>(bytes);
+        data.push_back(std::move(*component));
+        component->~T();
+      }
+    } else {
+      Logger::Err("Tried to restore a component that cannot be saved");
+      Clear();
+      return false;
+    }
+
+    addedTicks.assign(size, tick);
+    changedTicks.assign(size, tick);
+    return !reader.Failed();
+  }
+
+  // Exchanges two slots, along with the entities that own them
+  void Swap(int indexA, int indexB) {
+    if (indexA == indexB) {
+      return;
+    }
+
+    std::swap(data[indexA], data[indexB]);
+    std::swap(indexToEntityId[indexA], indexToEntityId[indexB]);
+    std::swap(addedTicks[indexA], addedTicks[indexB]);
+    std::swap(changedTicks[indexA], changedTicks[indexB]);
+    entityIdToIndex[indexToEntityId[indexA]] = indexA;
+    entityIdToIndex[indexToEntityId[indexB]] = indexB;
+  }
+
+  T& Get(int entityId) { return data[entityIdToIndex[entityId]]; }
+
+  // Slot of the entity's component in [0, GetSize())
+  int GetIndex(int entityId) const { return entityIdToIndex[entityId]; }
+
+  unsigned int GetAddedTick(int entityId) const override {
+    return addedTicks[entityIdToIndex[entityId]];
+  }
+  unsigned int GetChangedTick(int entityId) const override {
+    return changedTicks[entityIdToIndex[entityId]];
+  }
+
+  // Stamps the component in the given slot as written at tick
+  void SetChangedTick(int index, unsigned int tick) { changedTicks[index] = tick; }
+
+  // Packed access, index is a slot in [0, GetSize())
+  T& operator[](unsigned int index) { return data[index]; }
+
+  T* GetData() { return data.data(); }
+
+  int GetEntityId(int index) const { return indexToEntityId[index]; }
+
+  const std::vector<int>& GetEntityIds() const { return indexToEntityId; }
+};
+
+// Owning group, keeps the entities that have all of its components in the
+// packed prefix [0, GetSize()) of each of its pools, in the same order, so
+// that slot i of every owned pool belongs to the same entity. A pool can be
+// owned by a single group.
+class IGroup {
+ protected:
+  Signature signature;
+  int size = 0;
+
+ public:
+  virtual ~IGroup() = default;
+
+  const Signature& GetSignature() const { return signature; }
+  int GetSize() const { return size; }
+
+  // Called after the entity gained, and before it loses, an owned component
+  virtual void OnComponentAdded(int entityId) = 0;
+  virtual void OnComponentRemoved(int entityId) = 0;
+
+  // Gathers the group again after its pools were replaced
+  virtual void Rebuild() = 0;
+};
+
+template <typename... TComponents>
+class Group : public IGroup {
+ private:
+  std::tuple<Pool<TComponents>*...> pools;
+
+  Pool<typename std::tuple_element<0, std::tuple<TComponents...>>::type>* GetLeadPool() const {
+    return std::get<0>(pools);
+  }
+
+  bool HasAll(int entityId) const {
+    return (std::get<Pool<TComponents>*>(pools)->HasEntity(entityId) && ...);
+  }
+
+  bool Contains(int entityId) const {
+    return HasAll(entityId) && GetLeadPool()->GetIndex(entityId) < size;
+  }
+
+  void SwapAll(int indexA, int indexB) {
+    (std::get<Pool<TComponents>*>(pools)->Swap(indexA, indexB), ...);
+  }
+
+ public:
+  Group(Pool<TComponents>*... pools) : pools(pools...) {
+    (signature.set(Component<TComponents>::GetId()), ...);
+    Rebuild();
+  }
+
+  void Rebuild() override {
+    // Gather the entities that already have all the components
+    size = 0;
+    const auto& entityIds = GetLeadPool()->GetEntityIds();
+    for (int index = 0; index < static_cast<int>(entityIds.size()); index++) {
+      OnComponentAdded(entityIds[index]);
+    }
+  }
+
+  void OnComponentAdded(int entityId) override {
+    if (!HasAll(entityId) || Contains(entityId)) {
+      return;
+    }
+
+    (std::get<Pool<TComponents>*>(pools)->Swap(
+         std::get<Pool<TComponents>*>(pools)->GetIndex(entityId), size), ...);
+    size++;
+  }
+
+  void OnComponentRemoved(int entityId) override {
+    if (!Contains(entityId)) {
+      return;
+    }
+
+    size--;
+    (std::get<Pool<TComponents>*>(pools)->Swap(
+         std::get<Pool<TComponents>*>(pools)->GetIndex(entityId), size), ...);
+  }
+
+  // Reorders the group with a stable sort on TComponent, moving the other
+  // owned components along. Costs one pass when already in order. The
+  // permutation is built in memory from allocator.
+  template <typename TComponent, typename TCompare, typename TAllocator = std::allocator<int>>
+  void SortBy(TCompare compare, const TAllocator& allocator = TAllocator()) {
+    Pool<TComponent>* pool = std::get<Pool<TComponent>*>(pools);
+    TComponent* data = pool->GetData();
+
+    if (std::is_sorted(data, data + size, compare)) {
+      return;
+    }
+
+    // order[i] is the slot whose components belong at slot i
+    std::vector<int, TAllocator> order(size, allocator);
+    for (int i = 0; i < size; i++) {
+      order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [data, &compare](int a, int b) {
+      return compare(data[a], data[b]);
+    });
+
+    // Apply the permutation one cycle at a time
+    for (int i = 0; i < size; i++) {
+      int current = i;
+      while (order[current] != i) {
+        const int next = order[current];
+        SwapAll(current, next);
+        order[current] = current;
+        current = next;
+      }
+      order[current] = current;
+    }
+  }
+};
+
+const unsigned int ARCHETYPE_CHUNK_SIZE = 16 * 1024;
+
+// Fixed-size block of memory holding the rows of one archetype
+struct alignas(64) ArchetypeChunk {
+  unsigned char bytes[ARCHETYPE_CHUNK_SIZE];
+};
+
+// All the entities that have exactly the same signature. Rows are stored in
+// chunks, each chunk laid out as one contiguous array per component (SoA)
+// preceded by the array of the entity ids that own the rows. The added and
+// changed ticks of every column are kept outside the chunks, indexed by row.
+class Archetype {
+ private:
+  Signature signature;
+  std::vector<int> componentIds;
+  std::vector<int> columnOffsets;
+  std::vector<int> componentIdToColumn;
+  int chunkCapacity;
+  int numRows = 0;
+  std::vector<std::unique_ptr<ArchetypeChunk>> chunks;
+  std::vector<std::vector<unsigned int>> addedTicks;
+  std::vector<std::vector<unsigned int>> changedTicks;
+
+ public:
+  Archetype(const Signature& signature);
+  ~Archetype();
+
+  const Signature& GetSignature() const { return signature; }
+  const std::vector<int>& GetComponentIds() const { return componentIds; }
+  int GetNumRows() const { return numRows; }
+  int GetChunkCapacity() const { return chunkCapacity; }
+  int GetNumChunks() const { return (numRows + chunkCapacity - 1) / chunkCapacity; }
+  int GetChunkSize(int chunkIndex) const;
+
+  // Column of the component in this archetype, or -1 if it has none
+  int GetColumn(int componentId) const { return componentIdToColumn[componentId]; }
+
+  int* GetEntityIds(int chunkIndex);
+  void* GetColumnData(int chunkIndex, int column);
+  void* GetComponent(int row, int column);
+
+  // Ticks of every row of the column
+  unsigned int* GetAddedTicks(int column) { return addedTicks[column].data(); }
+  unsigned int* GetChangedTicks(int column) { return changedTicks[column].data(); }
+
+  template <typename TComponent>
+  TComponent* GetColumnData(int chunkIndex) {
+    const int column = GetColumn(Component<TComponent>::GetId());
+    return static_cast<TComponent*>(GetColumnData(chunkIndex, column));
+  }
+
+  // Appends a row for the entity. Its components are left unconstructed and
+  // must be constructed by the caller.
+  int AddRow(int entityId);
+
+  // Appends one row per entity, each a copy of sourceRow. Returns the first
+  // new row. Every component must be copyable.
+  int CloneRow(int sourceRow, const std::vector<int>& entityIds, unsigned int tick);
+
+  // Removes a row whose components were already destroyed by moving the
+  // last row into it. Returns the id of the moved entity, or -1.
+  int RemoveRow(int row);
+
+  void DestroyRow(int row);
+};
+
+// Location of an entity inside the archetype storage
+struct EntityLocation {
+  int archetype = -1;
+  int row = -1;
+};
+
+// Storage backend that groups the components of entities by archetype
+class ArchetypeStorage {
+ private:
+  std::vector<std::unique_ptr<Archetype>> archetypes;
+  std::unordered_map<Signature, int> archetypeIndices;
+  std::vector<EntityLocation> entityLocations;
+
+  int GetOrCreateArchetype(const Signature& signature);
+
+  // Moves the entity to the archetype of the given signature, leaving the
+  // components the new archetype does not have destroyed and the ones the
+  // old archetype did not have unconstructed. Returns the new row.
+  int MoveEntity(int entityId, const Signature& signature);
+
+ public:
+  ArchetypeStorage() = default;
+
+  const std::vector<std::unique_ptr<Archetype>>& GetArchetypes() const { return archetypes; }
+  const EntityLocation& GetLocation(int entityId) const { return entityLocations[entityId]; }
+
+  void ReserveEntities(int n) { entityLocations.reserve(n); }
+
+  // Adds or replaces the component of the entity, stamping it with tick
+  template <typename TComponent, typename... TArgs>
+  void AddComponent(int entityId, unsigned int tick, TArgs&&... args);
+  void RemoveComponent(int entityId, int componentId);
+  template <typename TComponent>
+  TComponent& GetComponent(int entityId) const;
+
+  unsigned int GetAddedTick(int entityId, int componentId) const;
+  unsigned int GetChangedTick(int entityId, int componentId) const;
+  void SetChangedTick(int entityId, int componentId, unsigned int tick);
+
+  void RemoveEntity(int entityId);
+
+  // Places every entity, none of which is stored yet, in the archetype of
+  // sourceEntityId with a copy of its components
+  void CloneEntity(int sourceEntityId, const std::vector<int>& entityIds, unsigned int tick);
+
+  // Destroys every archetype along with its components
+  void Clear();
+
+  // Saves every archetype with the ids of the entities of its rows, see
+  // IPool::Write and IPool::Read
+  void Write(SnapshotWriter& writer) const;
+  bool Read(SnapshotReader& reader, int numEntities, unsigned int tick);
+};
+
+template <typename TComponent, typename... TArgs>
+void ArchetypeStorage::AddComponent(int entityId, unsigned int tick, TArgs&&... args) {
+  const auto componentId = Component<TComponent>::GetId();
+  Component<TComponent>::RegisterTypeInfo();
+
+  GrowToFit(entityLocations, entityId);
+
+  Signature signature;
+  const auto& location = entityLocations[entityId];
+  if (location.archetype != -1) {
+    signature = archetypes[location.archetype]->GetSignature();
+
+    if (signature.test(componentId)) {
+      if constexpr (!IsTag<TComponent>::value) {
+        GetComponent<TComponent>(entityId) = TComponent(std::forward<TArgs>(args)...);
+        SetChangedTick(entityId, componentId, tick);
+      }
+      return;
+    }
+  }
+  signature.set(componentId);
+
+  const int row = MoveEntity(entityId, signature);
+  if constexpr (IsTag<TComponent>::value) {
+    return;
+  }
+  auto& archetype = archetypes[entityLocations[entityId].archetype];
+  const int column = archetype->GetColumn(componentId);
+  new (archetype->GetComponent(row, column)) TComponent(std::forward<TArgs>(args)...);
+  archetype->GetAddedTicks(column)[row] = tick;
+  archetype->GetChangedTicks(column)[row] = tick;
+}
+
+template <typename TComponent>
+TComponent& ArchetypeStorage::GetComponent(int entityId) const {
+  static_assert(!IsTag<TComponent>::value, "Tag components have no storage");
+  const auto& location = entityLocations[entityId];
+  auto& archetype = archetypes[location.archetype];
+  const int column = archetype->GetColumn(Component<TComponent>::GetId());
+
+  return *static_cast<TComponent*>(archetype->GetComponent(location.row, column));
 }
 
-class IPool {
- public:
-  virtual ~IPool() {}
-};
+template <typename... TComponents>
+class ComponentView;
 
+// Component stored for a view parameter, which is const when only read
 template <typename T>
-class Pool : public IPool {
+using StoredComponent = typename std::remove_const<T>::type;
+
+// Bytes of components handed to one job by ComponentView::ParallelEach, small
+// enough for a batch to stay in the L2 cache of the worker
+const unsigned int PARALLEL_BATCH_SIZE = 64 * 1024;
+
+// Structural changes made to a registry during one frame
+struct RegistryStats {
+  int entitiesCreated = 0;
+  int entitiesKilled = 0;
+  int componentsAdded = 0;
+  int componentsRemoved = 0;
+  int signatureChanges = 0;
+  int commandsReplayed = 0;
+};
+
+// Records structural changes (creating and killing entities, adding and
+// removing components) so that worker threads can request them without
+// touching the registry. Registry::Update replays the recorded commands.
+// Every thread records into its own buffer, see Registry::GetCommandBuffer.
+class CommandBuffer {
  private:
-  std::vector<T> data;
+  enum CommandType {
+    COMMAND_CREATE,
+    COMMAND_KILL,
+    COMMAND_ADD_COMPONENT,
+    COMMAND_REMOVE_COMPONENT
+  };
 
- public:
-  Pool(int size = 100) { data.resize(size); }
+  struct Command {
+    CommandType type;
+    int sortKey;
+    unsigned long long jobKey;
+    // Entities created by this buffer have the negative id -(index + 1)
+    Entity entity;
+    void* component;
+    void (*apply)(class Registry& registry, Entity entity, void* component);
+    void (*destroy)(void* component);
+  };
 
-  virtual ~Pool() = default;
+  static const unsigned int BLOCK_SIZE = 4096;
 
-  bool isEmpty() const { return data.empty(); }
+  std::vector<Command> commands;
+  std::vector<int> createSortKeys;
+  unsigned long long jobKey = 0;
+  // Components waiting to be added live in blocks that never move, so that
+  // recording does not relocate components that are not trivially copyable
+  std::vector<std::unique_ptr<unsigned char[]>> blocks;
+  unsigned int blockOffset = BLOCK_SIZE;
+
+  void* Allocate(size_t size, size_t alignment);
+  int GetSortKey(Entity entity) const;
 
-  int GetSize() const { return data.size(); }
+  friend class Registry;
+
+ public:
+  CommandBuffer() = default;
+  CommandBuffer(const CommandBuffer&) = delete;
+  CommandBuffer& operator=(const CommandBuffer&) = delete;
+  ~CommandBuffer() { Clear(); }
 
-  void Resize(int n) { data.resize(n); }
+  // Key of the job that records the next commands. Commands are replayed in
+  // the order of the entities they apply to, then of their job keys, then in
+  // the order they were recorded. Jobs that may record commands for the same
+  // entity must each set a key that does not depend on the thread running
+  // them, see MakeJobKey, at their start and again after waiting on other
+  // jobs. The key is reset to 0 by the replay.
+  void SetJobKey(unsigned long long jobKey) { this->jobKey = jobKey; }
 
-  void Clear() { data.clear(); }
+  // Job key from the index of the system and the index of the job, such as
+  // the batch, within the system's update
+  static unsigned long long MakeJobKey(unsigned int systemIndex, unsigned int jobIndex) {
+    return (static_cast<unsigned long long>(systemIndex) << 32) | jobIndex;
+  }
 
-  void Add(T object) { data.push_back(object); }
+  // Returns a handle that can only be used with the other commands of this
+  // buffer until the buffer is replayed. New entities are created in the
+  // order of `source`, the entity that caused them to be spawned.
+  Entity CreateEntity(Entity source);
+  void KillEntity(Entity entity);
+  template <typename TComponent, typename... TArgs>
+  void AddComponent(Entity entity, TArgs&&... args);
+  template <typename TComponent>
+  void RemoveComponent(Entity entity);
 
-  void Set(int index, T object) { data[index] = object; }
+  bool IsEmpty() const { return commands.empty(); }
 
-  T& Get(int index) { return static_cast<T&>(data[index]); }
+  // Drops the commands without applying them
+  void Clear();
+};
 
-  T& operator[](unsigned int index) { return data[index]; }
+// Where the registry keeps the component data
+enum StorageType {
+  STORAGE_POOL,
+  STORAGE_ARCHETYPE
 };
 
 class Registry {
  private:
+  StorageType storageType;
+  ArchetypeStorage archetypeStorage;
+
   int numEntities = 0;
+  int entityCapacity = 0;
+  // Current generation of every entity slot
+  std::vector<unsigned int> entityGenerations;
   std::vector<std::shared_ptr<IPool>> componentPools;
   std::vector<Signature> entityComponentSignatures;
 
   std::unordered_map<std::type_index, std::shared_ptr<System>> systems;
-  std::set<Entity> entitiesToBeAdded;
-  std::set<Entity> entitiesToBeKilled;
+
+  // Owning groups, and the group that owns the pool of every component id
+  std::unordered_map<std::type_index, std::shared_ptr<IGroup>> groups;
+  std::vector<IGroup*> componentGroups;
+  // Structural changes deferred to the next Update. Kills are de-duplicated
+  // with entityIsToBeKilled and both queues are processed sorted by id.
+  std::vector<Entity> entitiesToBeAdded;
+  std::vector<Entity> entitiesToBeKilled;
+  std::vector<bool> entityIsToBeKilled;
+
+  // Entities already registered with the systems whose signature changed
+  // since the last Update, with the signature the systems last saw
+  struct SignatureChange {
+    Entity entity;
+    Signature previousSignature;
+  };
+  std::vector<SignatureChange> signatureChanges;
+  std::vector<bool> entityHasSignatureChange;
+  std::vector<bool> entityIsInSystems;
 
   // List of free entity ids that were previously removed
   std::deque<int> freeIds;
 
+  RegistryStats currentFrameStats;
+  RegistryStats lastFrameStats;
+
+  // Stamped on every component added or written, advanced by Update and
+  // AdvanceTick
+  unsigned int changeTick = 1;
+
+  // One command buffer per thread that records structural changes
+  std::vector<std::unique_ptr<CommandBuffer>> commandBuffers;
+
+  void ReplayCommandBuffers();
+
+  template <typename TComponent>
+  Pool<TComponent>* GetOrCreateComponentPool();
+
+  // Must be called before the signature of a live entity is modified
+  void OnSignatureChange(Entity entity);
+  void UpdateEntitiesWithChangedSignature();
+
+  // Kills every entity at once, keeping the pools, groups and systems
+  void Clear();
+  // Whether every stored component can be saved and no command is waiting
+  bool CanSnapshot() const;
+  void WriteSnapshot(SnapshotWriter& writer) const;
+  bool ReadSnapshot(SnapshotReader& reader);
+  // Replaces the state of the registry, leaving it empty on failure
+  bool RestoreSnapshot(SnapshotReader& reader);
+
  public:
-  Registry() = default;
+  Registry(StorageType storageType = STORAGE_POOL) : storageType(storageType) {}
 
   void Update();
 
+  StorageType GetStorageType() const { return storageType; }
+
+  // Creates one command buffer per thread, indexed like
+  // JobSystem::GetThreadIndex
+  void CreateCommandBuffers(int numThreads);
+  CommandBuffer& GetCommandBuffer(int threadIndex) { return *commandBuffers[threadIndex]; }
+
+  // Structural changes applied by the last Update
+  const RegistryStats& GetLastFrameStats() const { return lastFrameStats; }
+  ArchetypeStorage& GetArchetypeStorage() { return archetypeStorage; }
+
+  // Current tick. A system that remembers the tick it last ran at can query
+  // what was added or changed since with ComponentView::Added and
+  // ComponentView::Changed.
+  unsigned int GetChangeTick() const { return changeTick; }
+
+  // Starts a new tick, so that every write from now on is newer than what
+  // the systems that already ran have seen. Called after every system that
+  // remembers its tick, between systems and never while one runs, since
+  // the tick is not atomic. SystemScheduler::Run does it after each stage.
+  void AdvanceTick() { changeTick++; }
+
   // Entity management
   Entity CreateEntity();
   void KillEntity(Entity entity);
 
+  // Whether the handle refers to an entity that has not been killed yet
+  bool Valid(Entity entity) const {
+    return entity.GetId() >= 0 && entity.GetId() < numEntities &&
+           entityGenerations[entity.GetId()] == entity.GetGeneration();
+  }
+
+  // Handle of the entity currently living in the given slot
+  Entity GetEntity(int entityId) const {
+    return Entity(entityId, entityGenerations[entityId]);
+  }
+
+  // Creates count entities at once. They are registered with the systems as
+  // one batch on the next Update. A count that is not positive is logged as
+  // an error and creates nothing.
+  std::vector<Entity> CreateEntities(int count);
+
+  // Preallocates room for n entities, so that loading a level of known size
+  // does not regrow the registry and pools while it is being populated
+  void ReserveEntities(int n);
+
+  // Creates count entities with a copy of every component of prefab. The
+  // components are copied in bulk, one append per component type. A count
+  // that is not positive is logged as an error and creates nothing.
+  std::vector<Entity> Instantiate(Entity prefab, int count);
+
+  // Saves the entities, their components, the structural changes waiting
+  // for the next Update and the entities of every system into one binary
+  // blob. Take it right after Update: the commands recorded by worker
+  // threads cannot be saved. Components are identified by id and systems by
+  // type name, so only the same build of the game can restore the blob.
+  // Empty if a component cannot be saved.
+  std::vector<unsigned char> Snapshot() const;
+
+  // Replaces the whole state of the registry with a snapshot. The registry
+  // must use the same storage and have the same systems as the one that
+  // took it. Restored components are stamped as added at a new tick, so
+  // that systems caching what they derived from them rebuild it. On failure
+  // the registry is left empty.
+  bool Restore(const std::vector<unsigned char>& snapshot);
+
+  // Saves a snapshot as a world file. The pools of trivially copyable
+  // components are laid out as page-aligned sections that LoadWorld can use
+  // in place. Like snapshots, world files are tied to the build that saved
+  // them.
+  bool SaveWorld(const std::string& path) const;
+
+  // Restores a world file. The file is mapped copy-on-write and the pools of
+  // trivially copyable components use its pages as their storage, so they
+  // are not copied at load time: a page is only copied when a component on
+  // it is written, and a pool moves to memory of its own the first time it
+  // grows or shrinks. Without mmap the file is read into memory instead.
+  bool LoadWorld(const std::string& path);
+
   // Component management
   template <typename TComponent, typename... TArgs>
   void AddComponent(Entity entity, TArgs&&... args);
+  // Adds components[i] to entities[i], moving the components into storage.
+  // Both vectors must have the same size, otherwise nothing is added. With
+  // pool storage the pool and its sparse map grow once for the whole batch,
+  // with archetype storage it costs the same as adding them one by one.
+  template <typename TComponent>
+  void AddComponents(const std::vector<Entity>& entities, std::vector<TComponent> components);
   template <typename TComponent>
   void RemoveComponent(Entity entity);
   template <typename TComponent>
   bool HasComponent(Entity entity) const;
+  // Writes through GetComponent are not tracked, use GetMutableComponent or
+  // MarkChanged for the changes that systems should notice
   template <typename TComponent> TComponent& GetComponent(Entity entity) const;
+  template <typename TComponent> TComponent& GetMutableComponent(Entity entity);
+  template <typename TComponent> void MarkChanged(Entity entity);
+  template <typename TComponent> Pool<TComponent>* GetComponentPool() const;
+
+  // Components the entity has, tags included
+  const Signature& GetEntitySignature(int entityId) const { return entityComponentSignatures[entityId]; }
+
+  // Ticks at which the component of the entity was added and last changed
+  unsigned int GetAddedTick(int entityId, int componentId) const;
+  unsigned int GetChangedTick(int entityId, int componentId) const;
+
+  // Preallocates room for n components of TComponent. Only meaningful with
+  // STORAGE_POOL, archetype chunks are allocated as their archetype fills.
+  template <typename TComponent>
+  void Reserve(int n);
+
+  // Query of the entities that have all of TComponents
+  template <typename... TComponents>
+  ComponentView<TComponents...> View();
+
+  // Owning groups. Views over exactly the components of a group iterate its
+  // aligned pools without lookups. Only meaningful with STORAGE_POOL, the
+  // archetype chunks already keep the components of an entity together.
+  template <typename... TComponents>
+  void AddGroup();
+  template <typename... TComponents>
+  bool HasGroup() const;
+  template <typename... TComponents>
+  Group<TComponents...>& GetGroup() const;
+
+  // Group that owns the pool of the component, or nullptr
+  IGroup* GetOwningGroup(int componentId) const {
+    return componentId < static_cast<int>(componentGroups.size()) ? componentGroups[componentId] : nullptr;
+  }
 
   // System management
   template <typename TSystem, typename... TArgs>
@@ -156,6 +1492,7 @@ class Registry {
   TSystem& GetSystem() const;
 
   void AddEntityToSystems(Entity entity);
+  void AddEntitiesToSystems(const std::vector<Entity>& entities);
   void RemoveEntityFromSystems(Entity entity);
 };
 
@@ -190,6 +1527,116 @@ void Registry::AddComponent(Entity entity, TArgs&&... args) {
   const auto componentId = Component<TComponent>::GetId();
   const auto entityId = entity.GetId();
 
+  if (!Valid(entity)) {
+    Logger::Err("Tried to add a component to a dead entity id = " + std::to_string(entityId));
+    return;
+  }
+
+  if (!entityComponentSignatures[entityId].test(componentId)) {
+    OnSignatureChange(entity);
+  }
+  currentFrameStats.componentsAdded++;
+
+  if (storageType == STORAGE_ARCHETYPE) {
+    archetypeStorage.AddComponent<TComponent>(entityId, changeTick, std::forward<TArgs>(args)...);
+    entityComponentSignatures[entityId].set(componentId);
+    return;
+  }
+
+  // Tags only need their bit in the signature
+  if constexpr (!IsTag<TComponent>::value) {
+    Pool<TComponent>* componentPool = GetOrCreateComponentPool<TComponent>();
+    componentPool->Set(entityId, TComponent(std::forward<TArgs>(args)...), changeTick);
+  }
+  entityComponentSignatures[entityId].set(componentId);
+
+  if (auto group = GetOwningGroup(componentId)) {
+    group->OnComponentAdded(entityId);
+  }
+
+  //Logger::Log("Component id = " + std::to_string(componentId) +
+             // " was added to entity id " + std::to_string(entityId));
+}
+
+template <typename TComponent>
+void Registry::AddComponents(const std::vector<Entity>& entities, std::vector<TComponent> components) {
+  const auto componentId = Component<TComponent>::GetId();
+
+  if (components.size() != entities.size()) {
+    Logger::Err("Tried to add " + std::to_string(components.size()) + " components to " +
+                std::to_string(entities.size()) + " entities");
+    return;
+  }
+
+  if (storageType == STORAGE_ARCHETYPE || IsTag<TComponent>::value) {
+    for (unsigned int i = 0; i < entities.size(); i++) {
+      AddComponent<TComponent>(entities[i], std::move(components[i]));
+    }
+    return;
+  }
+
+  if constexpr (!IsTag<TComponent>::value) {
+    Pool<TComponent>* componentPool = GetOrCreateComponentPool<TComponent>();
+    componentPool->Reserve(componentPool->GetSize() + entities.size());
+    int maxEntityId = -1;
+    for (auto entity : entities) {
+      maxEntityId = std::max(maxEntityId, entity.GetId());
+    }
+    componentPool->GrowEntityIds(maxEntityId);
+
+    // The usual batch, live entities that do not have the component yet, is
+    // appended in one go
+    bool areAllNew = true;
+    for (auto entity : entities) {
+      if (!Valid(entity) || entityComponentSignatures[entity.GetId()].test(componentId)) {
+        areAllNew = false;
+        break;
+      }
+    }
+    if (areAllNew && componentPool->Append(entities, components, changeTick)) {
+      for (auto entity : entities) {
+        OnSignatureChange(entity);
+        entityComponentSignatures[entity.GetId()].set(componentId);
+      }
+      currentFrameStats.componentsAdded += entities.size();
+
+      if (auto group = GetOwningGroup(componentId)) {
+        for (auto entity : entities) {
+          group->OnComponentAdded(entity.GetId());
+        }
+      }
+      return;
+    }
+
+    for (unsigned int i = 0; i < entities.size(); i++) {
+      const auto entityId = entities[i].GetId();
+
+      if (!Valid(entities[i])) {
+        Logger::Err("Tried to add a component to a dead entity id = " + std::to_string(entityId));
+        continue;
+      }
+
+      if (!entityComponentSignatures[entityId].test(componentId)) {
+        OnSignatureChange(entities[i]);
+      }
+      currentFrameStats.componentsAdded++;
+
+      componentPool->Set(entityId, std::move(components[i]), changeTick);
+      entityComponentSignatures[entityId].set(componentId);
+
+      if (auto group = GetOwningGroup(componentId)) {
+        group->OnComponentAdded(entityId);
+      }
+    }
+  }
+}
+
+template <typename TComponent>
+Pool<TComponent>* Registry::GetOrCreateComponentPool() {
+  static_assert(!IsTag<TComponent>::value, "Tag components have no storage");
+  const auto componentId = Component<TComponent>::GetId();
+  Component<TComponent>::RegisterTypeInfo();
+
   if (componentId >= static_cast<int>(componentPools.size())) {
     componentPools.resize(componentId + 1, nullptr);
   }
@@ -197,22 +1644,20 @@ void Registry::AddComponent(Entity entity, TArgs&&... args) {
   if (!componentPools[componentId]) {
     std::shared_ptr<Pool<TComponent>> newComponentPool =
         std::make_shared<Pool<TComponent>>();
+    newComponentPool->ReserveEntityIds(entityCapacity);
     componentPools[componentId] = newComponentPool;
   }
 
-  std::shared_ptr<Pool<TComponent>> componentPool =
-      std::static_pointer_cast<Pool<TComponent>>(componentPools[componentId]);
-  if (entityId >= componentPool->GetSize()) {
-    componentPool->Resize(numEntities);
-  }
-
-  TComponent newComponent(std::forward<TArgs>(args)...);
-
-  componentPool->Set(entityId, newComponent);
-  entityComponentSignatures[entityId].set(componentId);
+  return static_cast<Pool<TComponent>*>(componentPools[componentId].get());
+}
 
-  //Logger::Log("Component id = " + std::to_string(componentId) +
-             // " was added to entity id " + std::to_string(entityId));
+template <typename TComponent>
+void Registry::Reserve(int n) {
+  if constexpr (!IsTag<TComponent>::value) {
+    if (storageType == STORAGE_POOL) {
+      GetOrCreateComponentPool<TComponent>()->Reserve(n);
+    }
+  }
 }
 
 template <typename TComponent>
@@ -220,6 +1665,23 @@ void Registry::RemoveComponent(Entity entity) {
   const auto componentId = Component<TComponent>::GetId();
   const auto entityId = entity.GetId();
 
+  if (!Valid(entity) || !entityComponentSignatures[entityId].test(componentId)) {
+    return;
+  }
+
+  OnSignatureChange(entity);
+  currentFrameStats.componentsRemoved++;
+
+  if (storageType == STORAGE_ARCHETYPE) {
+    archetypeStorage.RemoveComponent(entityId, componentId);
+  } else if (componentId < static_cast<int>(componentPools.size()) &&
+             componentPools[componentId]) {
+    if (auto group = GetOwningGroup(componentId)) {
+      group->OnComponentRemoved(entityId);
+    }
+    componentPools[componentId]->RemoveEntityFromPool(entityId);
+  }
+
   entityComponentSignatures[entityId].set(componentId, false);
 }
 
@@ -228,36 +1690,576 @@ bool Registry::HasComponent(Entity entity) const {
   const auto componentId = Component<TComponent>::GetId();
   const auto entityId = entity.GetId();
 
-  return entityComponentSignatures[entityId].test(componentId);
+  return Valid(entity) && entityComponentSignatures[entityId].test(componentId);
 }
 
 template <typename TComponent>
 TComponent& Registry::GetComponent(Entity entity) const {
+  static_assert(!IsTag<TComponent>::value, "Tag components have no storage");
   const auto componentId = Component<TComponent>::GetId();
   const auto entityId = entity.GetId();
 
-  auto componentPool = std::static_pointer_cast<Pool<TComponent>>(componentPools[componentId]);
+  if (storageType == STORAGE_ARCHETYPE) {
+    return archetypeStorage.GetComponent<TComponent>(entityId);
+  }
+
+  auto componentPool = static_cast<Pool<TComponent>*>(componentPools[componentId].get());
   return componentPool->Get(entityId);
 }
 
-template <typename TComponent, typename ...TArgs>
-void Entity::AddComponent(TArgs&& ...args) {
-  registry->AddComponent<TComponent>(*this, std::forward<TArgs>(args)...);
+template <typename TComponent>
+TComponent& Registry::GetMutableComponent(Entity entity) {
+  MarkChanged<TComponent>(entity);
+  return GetComponent<TComponent>(entity);
+}
+
+template <typename TComponent>
+void Registry::MarkChanged(Entity entity) {
+  static_assert(!IsTag<TComponent>::value, "Tag components have no storage");
+  const auto componentId = Component<TComponent>::GetId();
+  const auto entityId = entity.GetId();
+
+  if (storageType == STORAGE_ARCHETYPE) {
+    archetypeStorage.SetChangedTick(entityId, componentId, changeTick);
+    return;
+  }
+
+  auto componentPool = static_cast<Pool<TComponent>*>(componentPools[componentId].get());
+  componentPool->SetChangedTick(componentPool->GetIndex(entityId), changeTick);
+}
+
+// Returns the packed pool of TComponent, or nullptr if no entity ever had one
+// (always the case with STORAGE_ARCHETYPE)
+template <typename TComponent>
+Pool<TComponent>* Registry::GetComponentPool() const {
+  static_assert(!IsTag<TComponent>::value, "Tag components have no storage");
+  const auto componentId = Component<TComponent>::GetId();
+
+  if (componentId >= static_cast<int>(componentPools.size())) {
+    return nullptr;
+  }
+
+  return static_cast<Pool<TComponent>*>(componentPools[componentId].get());
+}
+
+// Iterates the entities that have all of TComponents straight out of the
+// component storage, yielding references to their components. With
+// STORAGE_POOL it walks the smallest of the pools, with STORAGE_ARCHETYPE it
+// walks the chunks of every matching archetype. Entities and components must
+// not be added or removed while iterating.
+// Components listed const are only read, the others are stamped as changed
+// for every entity the view yields, whether func writes them or not. That
+// stamping is pessimistic: a system that only sometimes writes should list
+// the component const and call Registry::MarkChanged (or
+// GetMutableComponent) when it does, so Changed filters skip the rest.
+// Tags cannot be listed, filter on them with With and Without instead.
+template <typename... TComponents>
+class ComponentView {
+  static_assert(!(IsTag<TComponents>::value || ...), "Tag components have no storage, use With<T>()");
+
+ private:
+  // Restricts the view to entities whose component was added or changed at
+  // a tick later than sinceTick
+  struct TickFilter {
+    int componentId;
+    unsigned int sinceTick;
+    bool added;
+  };
+
+  Registry* registry;
+  Signature signature;
+  // Components the entities must have, or must not have, on top of TComponents
+  Signature withSignature;
+  Signature withoutSignature;
+  unsigned int tick;
+  std::tuple<Pool<StoredComponent<TComponents>>*...> pools;
+  const std::vector<int>* candidates = nullptr;
+  // Size of the prefix of the group that owns exactly TComponents, whose
+  // pools are aligned, or -1
+  int groupSize = -1;
+  std::vector<Archetype*> archetypes;
+  std::vector<TickFilter> filters;
+
+  bool IsInPools(int entityId) const {
+    return (std::get<Pool<StoredComponent<TComponents>>*>(pools)->HasEntity(entityId) && ...);
+  }
+
+  int GetNumCandidates() const {
+    if (groupSize != -1) {
+      return groupSize;
+    }
+    return candidates ? candidates->size() : 0;
+  }
+
+  // Matching archetypes, with STORAGE_ARCHETYPE
+  void SelectArchetypes();
+
+  bool PassesFilters(int entityId) const;
+  bool PassesFilters(Archetype* archetype, int row) const;
+
+  template <typename T>
+  T& GetFromPool(int entityId) const;
+  template <typename T>
+  T& GetFromPoolSlot(int index) const;
+  template <typename T>
+  T& GetFromArchetype(Archetype* archetype, int row) const;
+
+  template <typename TFunc>
+  void EachInChunk(Archetype* archetype, int chunkIndex, TFunc& func);
+  template <typename TFunc>
+  void EachInCandidates(int begin, int end, TFunc& func);
+
+ public:
+  ComponentView(Registry* registry);
+
+  // Copy of the view that only yields the entities whose TComponent, which
+  // must be one of the components of the view, was added (or written) after
+  // sinceTick
+  template <typename TComponent>
+  ComponentView Added(unsigned int sinceTick) const;
+  template <typename TComponent>
+  ComponentView Changed(unsigned int sinceTick) const;
+
+  // Copy of the view that only yields the entities that have, or do not
+  // have, TComponent. Meant for tags, but any component works.
+  template <typename TComponent>
+  ComponentView With() const;
+  template <typename TComponent>
+  ComponentView Without() const;
+
+  // Calls func(Entity, TComponents&...) for every matching entity
+  template <typename TFunc>
+  void Each(TFunc func);
+
+  // Same as Each, but splits the entities in cache-sized batches that run
+  // as jobs, so func is called from several threads at once. Small views are
+  // iterated serially on the calling thread.
+  template <typename TFunc>
+  void ParallelEach(JobSystem& jobSystem, TFunc func);
+
+  class Iterator {
+   private:
+    ComponentView* view;
+    int archetypeIndex;
+    int position;
+
+    bool IsAtEnd() const {
+      if (view->registry->GetStorageType() == STORAGE_ARCHETYPE) {
+        return archetypeIndex >= static_cast<int>(view->archetypes.size());
+      }
+      return position >= view->GetNumCandidates();
+    }
+
+    void SkipToValid() {
+      if (view->registry->GetStorageType() == STORAGE_ARCHETYPE) {
+        while (!IsAtEnd()) {
+          Archetype* archetype = view->archetypes[archetypeIndex];
+
+          if (position >= archetype->GetNumRows()) {
+            archetypeIndex++;
+            position = 0;
+          } else if (!view->PassesFilters(archetype, position)) {
+            position++;
+          } else {
+            break;
+          }
+        }
+        return;
+      }
+      while (!IsAtEnd() && ((view->groupSize == -1 && !view->IsInPools((*view->candidates)[position])) ||
+                            !view->PassesFilters((*view->candidates)[position]))) {
+        position++;
+      }
+    }
+
+   public:
+    Iterator(ComponentView* view, int archetypeIndex, int position)
+        : view(view), archetypeIndex(archetypeIndex), position(position) {
+      SkipToValid();
+    }
+
+    std::tuple<Entity, TComponents&...> operator*() const {
+      if (view->registry->GetStorageType() == STORAGE_ARCHETYPE) {
+        Archetype* archetype = view->archetypes[archetypeIndex];
+        const int capacity = archetype->GetChunkCapacity();
+        const int entityId = archetype->GetEntityIds(position / capacity)[position % capacity];
+
+        return std::tuple<Entity, TComponents&...>(
+            view->registry->GetEntity(entityId),
+            view->template GetFromArchetype<TComponents>(archetype, position)...);
+      }
+
+      const int entityId = (*view->candidates)[position];
+      if (view->groupSize != -1) {
+        return std::tuple<Entity, TComponents&...>(
+            view->registry->GetEntity(entityId),
+            view->template GetFromPoolSlot<TComponents>(position)...);
+      }
+      return std::tuple<Entity, TComponents&...>(
+          view->registry->GetEntity(entityId),
+          view->template GetFromPool<TComponents>(entityId)...);
+    }
+
+    Iterator& operator++() {
+      position++;
+      SkipToValid();
+      return *this;
+    }
+
+    bool operator!=(const Iterator& other) const {
+      return archetypeIndex != other.archetypeIndex || position != other.position;
+    }
+  };
+
+  Iterator begin() { return Iterator(this, 0, 0); }
+  Iterator end() {
+    if (registry->GetStorageType() == STORAGE_ARCHETYPE) {
+      return Iterator(this, archetypes.size(), 0);
+    }
+    return Iterator(this, 0, GetNumCandidates());
+  }
+};
+
+template <typename... TComponents>
+ComponentView<TComponents...>::ComponentView(Registry* registry)
+    : registry(registry),
+      tick(registry->GetChangeTick()),
+      pools(registry->GetComponentPool<StoredComponent<TComponents>>()...) {
+  (signature.set(Component<StoredComponent<TComponents>>::GetId()), ...);
+
+  if (registry->GetStorageType() == STORAGE_ARCHETYPE) {
+    SelectArchetypes();
+    return;
+  }
+
+  // Nothing can match if one of the pools was never created
+  if ((!std::get<Pool<StoredComponent<TComponents>>*>(pools) || ...)) {
+    return;
+  }
+
+  // The members of a group that owns exactly these components are the
+  // aligned prefix of the pools
+  const int componentIds[] = {Component<StoredComponent<TComponents>>::GetId()...};
+  const IGroup* group = registry->GetOwningGroup(componentIds[0]);
+  if (group && group->GetSignature() == signature) {
+    candidates = &std::get<0>(pools)->GetEntityIds();
+    groupSize = group->GetSize();
+    return;
+  }
+
+  // Drive the iteration with the smallest pool
+  int smallestSize = -1;
+  auto drive = [&](auto* pool) {
+    if (smallestSize == -1 || pool->GetSize() < smallestSize) {
+      smallestSize = pool->GetSize();
+      candidates = &pool->GetEntityIds();
+    }
+  };
+  (drive(std::get<Pool<StoredComponent<TComponents>>*>(pools)), ...);
+}
+
+template <typename... TComponents>
+template <typename TComponent>
+ComponentView<TComponents...> ComponentView<TComponents...>::Added(unsigned int sinceTick) const {
+  static_assert(ComponentListIndex<TComponent, ComponentList<StoredComponent<TComponents>...>>::value != -1,
+                "Only the components of the view can be filtered");
+  ComponentView view(*this);
+  view.filters.push_back({Component<TComponent>::GetId(), sinceTick, true});
+  return view;
+}
+
+template <typename... TComponents>
+template <typename TComponent>
+ComponentView<TComponents...> ComponentView<TComponents...>::Changed(unsigned int sinceTick) const {
+  static_assert(ComponentListIndex<TComponent, ComponentList<StoredComponent<TComponents>...>>::value != -1,
+                "Only the components of the view can be filtered");
+  ComponentView view(*this);
+  view.filters.push_back({Component<TComponent>::GetId(), sinceTick, false});
+  return view;
 }
 
+template <typename... TComponents>
 template <typename TComponent>
-void Entity::RemoveComponent() {
-  registry->RemoveComponent<TComponent>(*this);
+ComponentView<TComponents...> ComponentView<TComponents...>::With() const {
+  ComponentView view(*this);
+  view.withSignature.set(Component<TComponent>::GetId());
+  view.SelectArchetypes();
+  return view;
 }
 
+template <typename... TComponents>
 template <typename TComponent>
-bool Entity::HasComponent() const {
-  return registry->HasComponent<TComponent>(*this);
+ComponentView<TComponents...> ComponentView<TComponents...>::Without() const {
+  ComponentView view(*this);
+  view.withoutSignature.set(Component<TComponent>::GetId());
+  view.SelectArchetypes();
+  return view;
+}
+
+template <typename... TComponents>
+void ComponentView<TComponents...>::SelectArchetypes() {
+  archetypes.clear();
+
+  if (registry->GetStorageType() != STORAGE_ARCHETYPE) {
+    return;
+  }
+
+  const Signature required = signature | withSignature;
+  for (auto& archetype : registry->GetArchetypeStorage().GetArchetypes()) {
+    if ((archetype->GetSignature() & required) == required &&
+        (archetype->GetSignature() & withoutSignature).none()) {
+      archetypes.push_back(archetype.get());
+    }
+  }
+}
+
+template <typename... TComponents>
+bool ComponentView<TComponents...>::PassesFilters(int entityId) const {
+  if (withSignature.any() || withoutSignature.any()) {
+    const Signature& entitySignature = registry->GetEntitySignature(entityId);
+
+    if ((entitySignature & withSignature) != withSignature || (entitySignature & withoutSignature).any()) {
+      return false;
+    }
+  }
+
+  for (const auto& filter : filters) {
+    const unsigned int componentTick = filter.added
+        ? registry->GetAddedTick(entityId, filter.componentId)
+        : registry->GetChangedTick(entityId, filter.componentId);
+
+    if (componentTick <= filter.sinceTick) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename... TComponents>
+bool ComponentView<TComponents...>::PassesFilters(Archetype* archetype, int row) const {
+  for (const auto& filter : filters) {
+    const int column = archetype->GetColumn(filter.componentId);
+    const unsigned int componentTick = filter.added
+        ? archetype->GetAddedTicks(column)[row]
+        : archetype->GetChangedTicks(column)[row];
+
+    if (componentTick <= filter.sinceTick) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename... TComponents>
+template <typename T>
+T& ComponentView<TComponents...>::GetFromPool(int entityId) const {
+  return GetFromPoolSlot<T>(std::get<Pool<StoredComponent<T>>*>(pools)->GetIndex(entityId));
+}
+
+template <typename... TComponents>
+template <typename T>
+T& ComponentView<TComponents...>::GetFromPoolSlot(int index) const {
+  auto pool = std::get<Pool<StoredComponent<T>>*>(pools);
+
+  if constexpr (!std::is_const<T>::value) {
+    pool->SetChangedTick(index, tick);
+  }
+  return (*pool)[index];
+}
+
+template <typename... TComponents>
+template <typename T>
+T& ComponentView<TComponents...>::GetFromArchetype(Archetype* archetype, int row) const {
+  const int column = archetype->GetColumn(Component<StoredComponent<T>>::GetId());
+
+  if constexpr (!std::is_const<T>::value) {
+    archetype->GetChangedTicks(column)[row] = tick;
+  }
+  return *static_cast<T*>(archetype->GetComponent(row, column));
+}
+
+template <typename... TComponents>
+template <typename TFunc>
+void ComponentView<TComponents...>::EachInChunk(Archetype* archetype, int chunkIndex, TFunc& func) {
+  const int count = archetype->GetChunkSize(chunkIndex);
+  const int firstRow = chunkIndex * archetype->GetChunkCapacity();
+  const int* entityIds = archetype->GetEntityIds(chunkIndex);
+  auto columns = std::make_tuple(
+      static_cast<TComponents*>(archetype->template GetColumnData<StoredComponent<TComponents>>(chunkIndex))...);
+
+  // Changed ticks of the written columns, nullptr for the read-only ones
+  unsigned int* changedTicks[] = {
+      std::is_const<TComponents>::value
+          ? nullptr
+          : archetype->GetChangedTicks(archetype->GetColumn(Component<StoredComponent<TComponents>>::GetId()))...};
+
+  for (int i = 0; i < count; i++) {
+    if (!filters.empty() && !PassesFilters(archetype, firstRow + i)) {
+      continue;
+    }
+    for (auto ticks : changedTicks) {
+      if (ticks) {
+        ticks[firstRow + i] = tick;
+      }
+    }
+    func(registry->GetEntity(entityIds[i]), std::get<TComponents*>(columns)[i]...);
+  }
+}
+
+template <typename... TComponents>
+template <typename TFunc>
+void ComponentView<TComponents...>::EachInCandidates(int begin, int end, TFunc& func) {
+  if (groupSize != -1) {
+    for (int i = begin; i < end; i++) {
+      const int entityId = (*candidates)[i];
+
+      if (PassesFilters(entityId)) {
+        func(registry->GetEntity(entityId), GetFromPoolSlot<TComponents>(i)...);
+      }
+    }
+    return;
+  }
+
+  for (int i = begin; i < end; i++) {
+    const int entityId = (*candidates)[i];
+
+    if (IsInPools(entityId) && PassesFilters(entityId)) {
+      func(registry->GetEntity(entityId), GetFromPool<TComponents>(entityId)...);
+    }
+  }
+}
+
+template <typename... TComponents>
+template <typename TFunc>
+void ComponentView<TComponents...>::Each(TFunc func) {
+  if (registry->GetStorageType() == STORAGE_ARCHETYPE) {
+    for (auto archetype : archetypes) {
+      for (int chunkIndex = 0; chunkIndex < archetype->GetNumChunks(); chunkIndex++) {
+        EachInChunk(archetype, chunkIndex, func);
+      }
+    }
+    return;
+  }
+
+  EachInCandidates(0, GetNumCandidates(), func);
+}
+
+template <typename... TComponents>
+template <typename TFunc>
+void ComponentView<TComponents...>::ParallelEach(JobSystem& jobSystem, TFunc func) {
+  const int rowSize = std::max<int>(1, (sizeof(TComponents) + ...));
+  const int entitiesPerBatch = std::max<int>(64, PARALLEL_BATCH_SIZE / rowSize);
+
+  // Either (archetype, chunk) pairs or [begin, end) ranges of candidates
+  std::vector<std::pair<int, int>> batches;
+  int numEntities = 0;
+
+  if (registry->GetStorageType() == STORAGE_ARCHETYPE) {
+    // Archetype chunks are already contiguous and cache-sized
+    for (unsigned int i = 0; i < archetypes.size(); i++) {
+      for (int chunkIndex = 0; chunkIndex < archetypes[i]->GetNumChunks(); chunkIndex++) {
+        batches.emplace_back(i, chunkIndex);
+      }
+      numEntities += archetypes[i]->GetNumRows();
+    }
+  } else {
+    numEntities = GetNumCandidates();
+    for (int begin = 0; begin < numEntities; begin += entitiesPerBatch) {
+      batches.emplace_back(begin, std::min(begin + entitiesPerBatch, numEntities));
+    }
+  }
+
+  // Not worth the jobs overhead
+  if (jobSystem.GetNumThreads() == 1 || numEntities < 2 * entitiesPerBatch) {
+    Each(func);
+    return;
+  }
+
+  auto runBatch = [this, &func, &batches](int batchIndex) {
+    const auto& batch = batches[batchIndex];
+
+    if (registry->GetStorageType() == STORAGE_ARCHETYPE) {
+      EachInChunk(archetypes[batch.first], batch.second, func);
+    } else {
+      EachInCandidates(batch.first, batch.second, func);
+    }
+  };
+
+  JobCounter counter;
+  for (unsigned int i = 0; i < batches.size(); i++) {
+    jobSystem.Schedule([&runBatch, i]() { runBatch(i); }, counter);
+  }
+  jobSystem.Wait(counter);
+}
+
+template <typename TComponent, typename... TArgs>
+void CommandBuffer::AddComponent(Entity entity, TArgs&&... args) {
+  static_assert(alignof(TComponent) <= alignof(std::max_align_t),
+                "Over-aligned components cannot be recorded in a command buffer");
+
+  void* component = Allocate(sizeof(TComponent), alignof(TComponent));
+  new (component) TComponent(std::forward<TArgs>(args)...);
+
+  commands.push_back({
+      COMMAND_ADD_COMPONENT, GetSortKey(entity), jobKey, entity, component,
+      [](Registry& registry, Entity entity, void* component) {
+        auto recorded = static_cast<TComponent*>(component);
+        registry.AddComponent<TComponent>(entity, std::move(*recorded));
+        recorded->~TComponent();
+      },
+      [](void* component) { static_cast<TComponent*>(component)->~TComponent(); }});
 }
 
 template <typename TComponent>
-TComponent& Entity::GetComponent() const {
-  return registry->GetComponent<TComponent>(*this);
+void CommandBuffer::RemoveComponent(Entity entity) {
+  commands.push_back({
+      COMMAND_REMOVE_COMPONENT, GetSortKey(entity), jobKey, entity, nullptr,
+      [](Registry& registry, Entity entity, void*) {
+        registry.RemoveComponent<TComponent>(entity);
+      },
+      nullptr});
+}
+
+template <typename... TComponents>
+ComponentView<TComponents...> Registry::View() {
+  return ComponentView<TComponents...>(this);
+}
+
+template <typename... TComponents>
+void Registry::AddGroup() {
+  static_assert(sizeof...(TComponents) > 1, "A group needs at least two components");
+  static_assert(!(IsTag<TComponents>::value || ...), "Tag components have no storage");
+
+  if (storageType == STORAGE_ARCHETYPE) {
+    return;
+  }
+
+  const int componentIds[] = {Component<TComponents>::GetId()...};
+  for (auto componentId : componentIds) {
+    if (GetOwningGroup(componentId)) {
+      Logger::Err("Component id = " + std::to_string(componentId) + " is already owned by a group");
+      return;
+    }
+  }
+
+  auto newGroup = std::make_shared<Group<TComponents...>>(GetOrCreateComponentPool<TComponents>()...);
+  groups.insert(std::make_pair(std::type_index(typeid(Group<TComponents...>)), newGroup));
+
+  for (auto componentId : componentIds) {
+    GrowToFit<IGroup*>(componentGroups, componentId, nullptr);
+    componentGroups[componentId] = newGroup.get();
+  }
+}
+
+template <typename... TComponents>
+bool Registry::HasGroup() const {
+  return groups.find(std::type_index(typeid(Group<TComponents...>))) != groups.end();
+}
+
+template <typename... TComponents>
+Group<TComponents...>& Registry::GetGroup() const {
+  auto group = groups.find(std::type_index(typeid(Group<TComponents...>)));
+  return *(std::static_pointer_cast<Group<TComponents...>>(group->second));
 }
 
 #endif
\ No newline at end of file
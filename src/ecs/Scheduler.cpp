@@ -0,0 +1,39 @@
+#include "Scheduler.h"
+
+void SystemScheduler::AddSystem(const System& system, std::function<void(double)> update) {
+  const int index = scheduledSystems.size();
+
+  int stage = 0;
+  for (unsigned int i = 0; i < stages.size(); i++) {
+    for (auto other : stages[i]) {
+      if (system.ConflictsWith(*scheduledSystems[other].system)) {
+        stage = i + 1;
+      }
+    }
+  }
+
+  scheduledSystems.push_back({&system, std::move(update)});
+  if (stage >= static_cast<int>(stages.size())) {
+    stages.resize(stage + 1);
+  }
+  stages[stage].push_back(index);
+}
+
+void SystemScheduler::Run(double deltaTime, Registry& registry, JobSystem& jobSystem) {
+  for (const auto& stage : stages) {
+    if (stage.size() == 1) {
+      scheduledSystems[stage[0]].update(deltaTime);
+    } else {
+      JobCounter counter;
+      for (auto index : stage) {
+        auto& update = scheduledSystems[index].update;
+        jobSystem.Schedule([&update, deltaTime]() { update(deltaTime); }, counter);
+      }
+      jobSystem.Wait(counter);
+    }
+
+    // The systems of a stage never write what another one of the stage
+    // reads, so one tick per stage is enough
+    registry.AdvanceTick();
+  }
+}
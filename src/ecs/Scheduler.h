@@ -0,0 +1,39 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <functional>
+#include <vector>
+
+#include "ECS.h"
+#include "../jobs/JobSystem.h"
+
+// Runs the update of a list of systems every frame. The systems are grouped
+// in stages from the component access they declared: a system goes in the
+// stage after the last earlier system it conflicts with, so conflicting
+// systems always run in the order they were added, while the systems of a
+// stage run at the same time as jobs.
+class SystemScheduler {
+ private:
+  struct ScheduledSystem {
+    const System* system;
+    std::function<void(double)> update;
+  };
+
+  std::vector<ScheduledSystem> scheduledSystems;
+  std::vector<std::vector<int>> stages;
+
+ public:
+  SystemScheduler() = default;
+
+  // Schedules update to run every frame for the given system
+  void AddSystem(const System& system, std::function<void(double)> update);
+
+  // Runs every stage, advancing the change tick of the registry after each
+  // one so that the systems of later stages, and whatever runs after the
+  // scheduler, write at a tick newer than the one the earlier systems saw
+  void Run(double deltaTime, Registry& registry, JobSystem& jobSystem);
+
+  const std::vector<std::vector<int>>& GetStages() const { return stages; }
+};
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef EVENTBUS_H
+#define EVENTBUS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Member function of TOwner that handles events of type TEvent
+template <typename TMethod>
+struct EventHandlerTraits;
+
+template <typename TOwner, typename TEvent>
+struct EventHandlerTraits<void (TOwner::*)(const TEvent&)> {
+  using Owner = TOwner;
+  using Event = TEvent;
+};
+
+// Used to assign a unique id to an event type, the index of its queue
+struct IEventType {
+ protected:
+  inline static std::atomic<int> nextId{0};
+};
+
+template <typename TEvent>
+class EventType : public IEventType {
+ public:
+  static int GetId() {
+    static auto id = nextId++;
+    return id;
+  }
+};
+
+class IEventQueue {
+ public:
+  virtual ~IEventQueue() = default;
+  virtual void Dispatch() = 0;
+  virtual void Unsubscribe(const void* owner) = 0;
+  virtual void Clear() = 0;
+};
+
+// Events of one type, packed in the order they were emitted. Both buffers
+// keep their capacity from frame to frame, so a steady stream of events
+// does not allocate once the queue has grown to its peak.
+template <typename TEvent>
+class EventQueue : public IEventQueue {
+ private:
+  // Called once per batch, with every event of the frame
+  struct Subscriber {
+    void* owner;
+    void (*handleBatch)(void* owner, const TEvent* events, size_t numEvents);
+  };
+
+  std::vector<TEvent> events;
+  // Events being dispatched, so that handlers can emit new ones
+  std::vector<TEvent> dispatchedEvents;
+  std::vector<Subscriber> subscribers;
+  // Set while the handlers run. Unsubscribing then only clears the owner of
+  // the subscription, the list is compacted once the batch is done.
+  bool isDispatching = false;
+
+  void RemoveSubscribers(const void* owner) {
+    subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(),
+                                     [owner](const Subscriber& subscriber) { return subscriber.owner == owner; }),
+                      subscribers.end());
+  }
+
+ public:
+  template <typename... TArgs>
+  void Emit(TArgs&&... args) { events.emplace_back(std::forward<TArgs>(args)...); }
+
+  template <auto Handler>
+  void Subscribe(typename EventHandlerTraits<decltype(Handler)>::Owner* owner) {
+    using Owner = typename EventHandlerTraits<decltype(Handler)>::Owner;
+
+    // The handler is a template argument, so the loop calls it directly
+    subscribers.push_back({owner, [](void* owner, const TEvent* events, size_t numEvents) {
+                             auto* handlerOwner = static_cast<Owner*>(owner);
+                             for (size_t i = 0; i < numEvents; i++) {
+                               (handlerOwner->*Handler)(events[i]);
+                             }
+                           }});
+  }
+
+  void Unsubscribe(const void* owner) override {
+    if (!isDispatching) {
+      RemoveSubscribers(owner);
+      return;
+    }
+
+    for (auto& subscriber : subscribers) {
+      if (subscriber.owner == owner) {
+        subscriber.owner = nullptr;
+      }
+    }
+  }
+
+  void Dispatch() override {
+    // A handler dispatching again would overwrite the batch being handled,
+    // its events wait for the next Dispatch instead
+    if (events.empty() || isDispatching) {
+      return;
+    }
+
+    std::swap(events, dispatchedEvents);
+    isDispatching = true;
+    // Subscribers added by a handler start with the next batch
+    const size_t numSubscribers = subscribers.size();
+    for (size_t i = 0; i < numSubscribers; i++) {
+      // Copied, a handler subscribing may reallocate the list
+      const Subscriber subscriber = subscribers[i];
+      if (subscriber.owner) {
+        subscriber.handleBatch(subscriber.owner, dispatchedEvents.data(), dispatchedEvents.size());
+      }
+    }
+    isDispatching = false;
+
+    RemoveSubscribers(nullptr);
+    dispatchedEvents.clear();
+  }
+
+  void Clear() override { events.clear(); }
+
+  bool HasSubscribers() const { return !subscribers.empty(); }
+  size_t GetSize() const { return events.size(); }
+};
+
+// Delivers the events emitted during a frame to the systems that subscribed
+// to them. Emitting appends the event to the queue of its type, Dispatch
+// hands every queue to its subscribers as one batch. Events of a type nobody
+// subscribed to are dropped.
+//
+// Emitting is not synchronized: the events of a type must be emitted by one
+// job at a time. Events emitted by a handler are dispatched on the next call
+// to Dispatch. Handlers may subscribe and unsubscribe: an owner unsubscribed
+// during a batch gets no further event, a new subscriber starts with the
+// next batch.
+class EventBus {
+ private:
+  std::vector<std::unique_ptr<IEventQueue>> queues;
+
+  template <typename TEvent>
+  EventQueue<TEvent>* GetQueue() const {
+    const int eventId = EventType<TEvent>::GetId();
+    if (eventId >= static_cast<int>(queues.size())) {
+      return nullptr;
+    }
+    return static_cast<EventQueue<TEvent>*>(queues[eventId].get());
+  }
+
+ public:
+  EventBus() = default;
+  EventBus(const EventBus&) = delete;
+  EventBus& operator=(const EventBus&) = delete;
+
+  // Calls Handler, a member function taking a const reference to the event,
+  // on owner for every event of its type. Subscribe the systems before
+  // events start being emitted: subscribing creates the queue.
+  template <auto Handler>
+  void Subscribe(typename EventHandlerTraits<decltype(Handler)>::Owner* owner) {
+    using Event = typename EventHandlerTraits<decltype(Handler)>::Event;
+    const int eventId = EventType<Event>::GetId();
+
+    if (eventId >= static_cast<int>(queues.size())) {
+      queues.resize(eventId + 1);
+    }
+    if (!queues[eventId]) {
+      queues[eventId] = std::make_unique<EventQueue<Event>>();
+    }
+    GetQueue<Event>()->template Subscribe<Handler>(owner);
+  }
+
+  // Removes every subscription of owner
+  void Unsubscribe(const void* owner) {
+    for (auto& queue : queues) {
+      if (queue) {
+        queue->Unsubscribe(owner);
+      }
+    }
+  }
+
+  template <typename TEvent, typename... TArgs>
+  void Emit(TArgs&&... args) {
+    auto* queue = GetQueue<TEvent>();
+    if (queue && queue->HasSubscribers()) {
+      queue->Emit(std::forward<TArgs>(args)...);
+    }
+  }
+
+  // Whether anyone would receive events of the type, to skip building them
+  template <typename TEvent>
+  bool HasSubscribers() const {
+    auto* queue = GetQueue<TEvent>();
+    return queue && queue->HasSubscribers();
+  }
+
+  // Events of the type waiting for the next Dispatch
+  template <typename TEvent>
+  size_t GetNumPendingEvents() const {
+    auto* queue = GetQueue<TEvent>();
+    return queue ? queue->GetSize() : 0;
+  }
+
+  void Dispatch() {
+    // By index, a handler subscribing to a new event type grows the queues
+    for (size_t i = 0; i < queues.size(); i++) {
+      if (queues[i]) {
+        queues[i]->Dispatch();
+      }
+    }
+  }
+
+  // Drops the events waiting to be dispatched
+  void Clear() {
+    for (auto& queue : queues) {
+      if (queue) {
+        queue->Clear();
+      }
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef COLLISIONEVENT_H
+#define COLLISIONEVENT_H
+
+#include "../ecs/ECS.h"
+
+// Emitted by the CollisionSystem for every pair of overlapping colliders
+struct CollisionEvent {
+    Entity a;
+    Entity b;
+
+    CollisionEvent(Entity a, Entity b) : a(a), b(b) {}
+};
+
+#endif
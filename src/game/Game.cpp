@@ -1,15 +1,14 @@
 #include "Game.h"
 #include "../logger/Logger.h"
 #include "../ecs/ECS.h"
-#include "../systems/MovementSystem.h"
-#include "../systems/AnimationSystem.h"
-#include "../systems/CollisionSystem.h"
+#include "../components/Components.h"
 #include "../systems/RenderSystem.h"
 #include "../components/TransformComponent.h"
 #include "../components/RigidBodyComponent.h"
 #include "../components/BoxColliderComponent.h"
 #include "../components/SpriteComponent.h"
 #include "../components/AnimationComponent.h"
+#include "../components/TagComponents.h"
 
 #include <glm/glm.hpp>
 #include <SDL2/SDL.h>
@@ -20,8 +19,10 @@
 
 Game::Game() { 
   isRunning = false; 
-  registry = std::make_unique<Registry>();
   assetStore = std::make_unique<AssetStore>();
+  jobSystem = std::make_unique<JobSystem>();
+  frameArena = std::make_unique<FrameArena>();
+  world = std::make_unique<World>(*assetStore, *jobSystem, *frameArena);
   millisecsPrevFrame = SDL_GetTicks();
 
   Logger::Log("Game constructor called");
@@ -62,10 +63,8 @@ void Game::Initialize() {
 }
 
 void Game::Setup() {
-  registry->AddSystem<MovementSystem>();
-  registry->AddSystem<RenderSystem>();
-  registry->AddSystem<AnimationSystem>();
-  registry->AddSystem<CollisionSystem>();
+  Registry& registry = world->GetRegistry();
+  registry.AddSystem<RenderSystem>();
 
   assetStore->AddTexture(renderer, "tank-image", "./assets/images/tank-panther-right.png");
   assetStore->AddTexture(renderer, "truck-image", "./assets/images/truck-ford-right.png");
@@ -78,9 +77,23 @@ void Game::Setup() {
   int mapNumCols = 25;
   int mapNumRows = 20;
 
+  // Keeps the transforms and rigid bodies the movement system walks every
+  // frame aligned. The renderer keeps its own draw-order queue instead.
+  registry.AddGroup<TransformComponent, RigidBodyComponent>();
+
+  registry.ReserveEntities(mapNumRows * mapNumCols + 2);
+  registry.Reserve<TransformComponent>(mapNumRows * mapNumCols + 2);
+  registry.Reserve<SpriteComponent>(mapNumRows * mapNumCols + 2);
+
   std::fstream mapFile;
   mapFile.open("./assets/tilemaps/jungle.map");
 
+  std::vector<Entity> tiles = registry.CreateEntities(mapNumRows * mapNumCols);
+  std::vector<TransformComponent> tileTransforms;
+  std::vector<SpriteComponent> tileSprites;
+  tileTransforms.reserve(tiles.size());
+  tileSprites.reserve(tiles.size());
+
   for (int y = 0; y < mapNumRows; y++) {
     for(int x = 0; x < mapNumCols; x++) {
       char ch;
@@ -93,25 +106,29 @@ void Game::Setup() {
 
       mapFile.ignore();
 
-      Entity tile = registry->CreateEntity();
-      tile.AddComponent<TransformComponent>(glm::vec2(x * (tileScale*tileSize), y * (tileScale*tileSize)), glm::vec2(tileScale, tileScale), 0.0);
-      tile.AddComponent<SpriteComponent>("tilemap-image", tileSize, tileSize, 0, srcRectX, srcRectY);
+      tileTransforms.emplace_back(glm::vec2(x * (tileScale*tileSize), y * (tileScale*tileSize)), glm::vec2(tileScale, tileScale), 0.0);
+      tileSprites.emplace_back("tilemap-image", tileSize, tileSize, 0, srcRectX, srcRectY);
     }
   }
+  registry.AddComponents<TransformComponent>(tiles, std::move(tileTransforms));
+  registry.AddComponents<SpriteComponent>(tiles, std::move(tileSprites));
+  registry.AddComponents<StaticTag>(tiles, std::vector<StaticTag>(tiles.size()));
   mapFile.close();
 
-  Entity tank = registry->CreateEntity();
-  tank.AddComponent<TransformComponent>(glm::vec2(10.0, 30.0), glm::vec2(3.0, 3.0), 0.0);
-  tank.AddComponent<RigidBodyComponent>(glm::vec2(50.0, 25.0));
-  tank.AddComponent<BoxColliderComponent>(32, 32);
-  tank.AddComponent<SpriteComponent>("tank-image", 32, 32, 1);
-
-  Entity helicopter = registry->CreateEntity();
-  helicopter.AddComponent<TransformComponent>(glm::vec2(10.0, 30.0), glm::vec2(3.0, 3.0), 0.0);
-  helicopter.AddComponent<RigidBodyComponent>(glm::vec2(75.0, 25.0));
-  helicopter.AddComponent<BoxColliderComponent>(32, 32);
-  helicopter.AddComponent<SpriteComponent>("chopper-image", 32, 32, 2);
-  helicopter.AddComponent<AnimationComponent>(2, 5, true);
+  Entity tank = registry.CreateEntity();
+  registry.AddComponent<TransformComponent>(tank, glm::vec2(10.0, 30.0), glm::vec2(3.0, 3.0), 0.0);
+  registry.AddComponent<RigidBodyComponent>(tank, glm::vec2(50.0, 25.0));
+  registry.AddComponent<BoxColliderComponent>(tank, 32, 32);
+  registry.AddComponent<SpriteComponent>(tank, "tank-image", 32, 32, 1);
+  registry.AddComponent<PlayerTag>(tank);
+
+  Entity helicopter = registry.CreateEntity();
+  registry.AddComponent<TransformComponent>(helicopter, glm::vec2(10.0, 30.0), glm::vec2(3.0, 3.0), 0.0);
+  registry.AddComponent<RigidBodyComponent>(helicopter, glm::vec2(75.0, 25.0));
+  registry.AddComponent<BoxColliderComponent>(helicopter, 32, 32);
+  registry.AddComponent<SpriteComponent>(helicopter, "chopper-image", 32, 32, 2);
+  registry.AddComponent<AnimationComponent>(helicopter, 2, 5, true);
+  registry.AddComponent<EnemyTag>(helicopter);
 
 }
 
@@ -153,17 +170,25 @@ void Game::Update() {
 
   millisecsPrevFrame = SDL_GetTicks();
 
-  registry->Update();
-  registry->GetSystem<MovementSystem>().Update(deltaTime);
-  registry->GetSystem<AnimationSystem>().Update(deltaTime);
-  registry->GetSystem<CollisionSystem>().Update(deltaTime);
+  // Release the transient buffers of the last frame, reporting it if it
+  // needed more of them than any frame before
+  const size_t highWaterBytes = frameArena->GetHighWaterBytes();
+  frameArena->Reset();
+  if (frameArena->GetHighWaterBytes() > highWaterBytes) {
+    Logger::Log("Frame arena high-water mark: " + std::to_string(frameArena->GetHighWaterBytes()) + " bytes");
+  }
+
+  world->Step(deltaTime);
 }
 
 void Game::Render() {
   SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
   SDL_RenderClear(renderer);
 
-  registry->GetSystem<RenderSystem>().Update(renderer, assetStore);
+  world->GetRegistry().GetSystem<RenderSystem>().Update(renderer, assetStore, world->GetRegistry());
+  // Input and gameplay writes made before the next frame must be newer than
+  // what the render system saw
+  world->GetRegistry().AdvanceTick();
 
   SDL_RenderPresent(renderer);
 }
@@ -3,8 +3,10 @@
 
 #include <memory>
 #include <SDL2/SDL.h>
-#include "../ecs/ECS.h"
+#include "../jobs/JobSystem.h"
 #include "../assetstore/AssetStore.h"
+#include "../memory/FrameArena.h"
+#include "World.h"
 
 const int FPS = 60;
 const int MILLISECS_PER_FRAME = 1000 / FPS;
@@ -16,8 +18,11 @@ class Game {
         SDL_Window *window;
         SDL_Renderer *renderer;
 
-        std::unique_ptr<Registry> registry;
         std::unique_ptr<AssetStore> assetStore;
+        std::unique_ptr<JobSystem> jobSystem;
+        // Transient buffers of the systems, released at the start of every frame
+        std::unique_ptr<FrameArena> frameArena;
+        std::unique_ptr<World> world;
 
     public:
         Game();
@@ -0,0 +1,61 @@
+#include "World.h"
+#include "../components/Components.h"
+#include "../systems/MovementSystem.h"
+#include "../systems/AnimationSystem.h"
+#include "../systems/CollisionSystem.h"
+#include "../systems/HierarchySystem.h"
+#include "../logger/Logger.h"
+
+World::World(const AssetStore& assetStore, JobSystem& jobSystem, FrameArena& frameArena, StorageType storageType)
+    : assetStore(assetStore), jobSystem(jobSystem), frameArena(frameArena) {
+  registry = std::make_unique<Registry>(storageType);
+  scheduler = std::make_unique<SystemScheduler>();
+  eventBus = std::make_unique<EventBus>();
+  registry->CreateCommandBuffers(jobSystem.GetNumThreads());
+
+  registry->AddSystem<MovementSystem>();
+  registry->AddSystem<AnimationSystem>();
+  registry->AddSystem<CollisionSystem>();
+  registry->AddSystem<HierarchySystem>();
+
+  // The simulation systems run on the scheduler, in this order wherever
+  // their component access conflicts
+  auto& movementSystem = registry->GetSystem<MovementSystem>();
+  auto& animationSystem = registry->GetSystem<AnimationSystem>();
+  auto& collisionSystem = registry->GetSystem<CollisionSystem>();
+  auto& hierarchySystem = registry->GetSystem<HierarchySystem>();
+  scheduler->AddSystem(movementSystem, [this, &movementSystem](double deltaTime) {
+    movementSystem.Update(deltaTime, *registry, this->jobSystem);
+  });
+  scheduler->AddSystem(animationSystem, [this, &animationSystem](double deltaTime) {
+    animationSystem.Update(deltaTime, *registry, this->jobSystem);
+  });
+  scheduler->AddSystem(collisionSystem, [this, &collisionSystem](double deltaTime) {
+    collisionSystem.Update(deltaTime, *registry, *eventBus, this->frameArena);
+  });
+  scheduler->AddSystem(hierarchySystem, [this, &hierarchySystem](double) {
+    hierarchySystem.Update(*registry);
+  });
+
+  eventBus->Subscribe<&World::OnCollision>(this);
+}
+
+void World::OnCollision(const CollisionEvent& event) {
+  Logger::Log("Collision between entity id = " + std::to_string(event.a.GetId()) + " and entity id = " +
+              std::to_string(event.b.GetId()));
+}
+
+void World::Step(double deltaTime) {
+  registry->Update();
+  scheduler->Run(deltaTime, *registry, jobSystem);
+  eventBus->Dispatch();
+}
+
+void World::StepAll(std::vector<std::unique_ptr<World>>& worlds, double deltaTime, JobSystem& jobSystem) {
+  JobCounter counter;
+  for (auto& world : worlds) {
+    World* steppedWorld = world.get();
+    jobSystem.Schedule([steppedWorld, deltaTime]() { steppedWorld->Step(deltaTime); }, counter);
+  }
+  jobSystem.Wait(counter);
+}
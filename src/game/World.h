@@ -0,0 +1,53 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <memory>
+#include <vector>
+#include "../ecs/ECS.h"
+#include "../ecs/Scheduler.h"
+#include "../jobs/JobSystem.h"
+#include "../assetstore/AssetStore.h"
+#include "../eventbus/EventBus.h"
+#include "../events/CollisionEvent.h"
+#include "../memory/FrameArena.h"
+
+// An isolated simulation: its own registry, simulation systems and
+// scheduler. Worlds only share the read-only asset store, the job system and
+// the frame arena of their systems' transient buffers, so several of them
+// (match instances, AI rollouts) can be stepped at once.
+class World {
+    private:
+        std::unique_ptr<Registry> registry;
+        std::unique_ptr<SystemScheduler> scheduler;
+        std::unique_ptr<EventBus> eventBus;
+        const AssetStore& assetStore;
+        JobSystem& jobSystem;
+        FrameArena& frameArena;
+
+        // Logs the collisions, as the collision system used to
+        void OnCollision(const CollisionEvent& event);
+
+    public:
+        World(const AssetStore& assetStore, JobSystem& jobSystem, FrameArena& frameArena,
+              StorageType storageType = STORAGE_POOL);
+
+        // The scheduled system updates capture this world, so it never moves
+        World(const World&) = delete;
+        World(World&&) = delete;
+        World& operator=(const World&) = delete;
+        World& operator=(World&&) = delete;
+
+        Registry& GetRegistry() { return *registry; }
+        EventBus& GetEventBus() { return *eventBus; }
+        const AssetStore& GetAssetStore() const { return assetStore; }
+        FrameArena& GetFrameArena() { return frameArena; }
+
+        // Applies the structural changes of the last step, runs the
+        // simulation systems, then dispatches the events they emitted
+        void Step(double deltaTime);
+
+        // Steps every world as a job of its own, returns once all are done
+        static void StepAll(std::vector<std::unique_ptr<World>>& worlds, double deltaTime, JobSystem& jobSystem);
+};
+
+#endif
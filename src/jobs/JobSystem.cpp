@@ -0,0 +1,122 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+// Job system and index of the worker running on this thread
+static thread_local const JobSystem* currentJobSystem = nullptr;
+static thread_local int currentThreadIndex = 0;
+
+JobSystem::JobSystem(int numThreads) {
+  if (numThreads <= 0) {
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  for (int i = 0; i < numThreads; i++) {
+    queues.push_back(std::make_unique<WorkerQueue>());
+  }
+
+  for (int i = 1; i < numThreads; i++) {
+    workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+  }
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    isStopping = true;
+  }
+  jobAvailable.notify_all();
+
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+int JobSystem::GetThreadIndex() const {
+  return currentJobSystem == this ? currentThreadIndex : 0;
+}
+
+void JobSystem::Schedule(std::function<void()> function, JobCounter& counter, int threadHint) {
+  const int threadIndex = threadHint >= 0 ? threadHint % GetNumThreads() : GetThreadIndex();
+
+  counter.pendingJobs.fetch_add(1, std::memory_order_relaxed);
+  {
+    std::lock_guard<std::mutex> lock(queues[threadIndex]->mutex);
+    queues[threadIndex]->jobs.push_back({std::move(function), &counter});
+  }
+  queuedJobs.fetch_add(1);
+
+  // Taking the lock orders the push before a worker going to sleep checks
+  // queuedJobs, so the wake up cannot be lost
+  { std::lock_guard<std::mutex> lock(sleepMutex); }
+  jobAvailable.notify_one();
+}
+
+void JobSystem::Wait(JobCounter& counter) {
+  const int threadIndex = GetThreadIndex();
+
+  while (!counter.IsDone()) {
+    Job job;
+    if (PopJob(threadIndex, job)) {
+      Execute(job);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void JobSystem::WorkerLoop(int threadIndex) {
+  currentJobSystem = this;
+  currentThreadIndex = threadIndex;
+
+  while (true) {
+    Job job;
+    if (PopJob(threadIndex, job)) {
+      Execute(job);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    jobAvailable.wait(lock, [&] { return isStopping || queuedJobs > 0; });
+    if (isStopping) {
+      return;
+    }
+  }
+}
+
+bool JobSystem::PopJob(int threadIndex, Job& job) {
+  if (queuedJobs.load() == 0) {
+    return false;
+  }
+
+  // Newest job of our own deque first, it is the most likely to be in cache
+  {
+    auto& queue = *queues[threadIndex];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.jobs.empty()) {
+      job = std::move(queue.jobs.back());
+      queue.jobs.pop_back();
+      queuedJobs.fetch_sub(1);
+      return true;
+    }
+  }
+
+  // Otherwise steal the oldest job of another deque
+  for (int i = 1; i < GetNumThreads(); i++) {
+    auto& queue = *queues[(threadIndex + i) % GetNumThreads()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.jobs.empty()) {
+      job = std::move(queue.jobs.front());
+      queue.jobs.pop_front();
+      queuedJobs.fetch_sub(1);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void JobSystem::Execute(Job& job) {
+  job.function();
+  job.counter->pendingJobs.fetch_sub(1, std::memory_order_release);
+}
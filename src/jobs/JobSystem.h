@@ -0,0 +1,76 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Number of jobs of a batch that have not finished yet. Schedule increments
+// it, finishing a job decrements it, JobSystem::Wait returns once it is 0.
+class JobCounter {
+ private:
+  std::atomic<int> pendingJobs{0};
+
+  friend class JobSystem;
+
+ public:
+  JobCounter() = default;
+  JobCounter(const JobCounter&) = delete;
+  JobCounter& operator=(const JobCounter&) = delete;
+
+  bool IsDone() const { return pendingJobs.load(std::memory_order_acquire) == 0; }
+};
+
+struct Job {
+  std::function<void()> function;
+  JobCounter* counter;
+};
+
+// Pool of worker threads that run jobs. Every thread has its own deque: it
+// pushes and pops its jobs at the back, and when it runs out of work it
+// steals from the front of the other deques. Thread 0 is whichever thread
+// drives the job system (the main loop), it runs jobs while it waits.
+class JobSystem {
+ private:
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+  };
+
+  std::vector<std::unique_ptr<WorkerQueue>> queues;
+  std::vector<std::thread> workers;
+
+  std::atomic<int> queuedJobs{0};
+  std::atomic<bool> isStopping{false};
+  std::mutex sleepMutex;
+  std::condition_variable jobAvailable;
+
+  void WorkerLoop(int threadIndex);
+  bool PopJob(int threadIndex, Job& job);
+  void Execute(Job& job);
+
+ public:
+  // numThreads counts the calling thread, 0 uses every hardware thread
+  JobSystem(int numThreads = 0);
+  ~JobSystem();
+
+  int GetNumThreads() const { return queues.size(); }
+
+  // Index of the calling thread in [0, GetNumThreads()), 0 for threads that
+  // are not workers of this job system
+  int GetThreadIndex() const;
+
+  // Queues a job. The affinity hint picks the thread whose deque receives
+  // it, by default the calling thread's own deque.
+  void Schedule(std::function<void()> function, JobCounter& counter, int threadHint = -1);
+
+  // Runs jobs until every job of the counter is done
+  void Wait(JobCounter& counter);
+};
+
+#endif
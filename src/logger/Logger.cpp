@@ -2,9 +2,13 @@
 #include <iostream>
 #include <chrono>
 #include <ctime>
+#include <mutex>
 
 std::vector<LogEntry> Logger::messages;
 
+// Systems may log from worker threads, std::localtime is not thread-safe either
+static std::mutex logMutex;
+
 std::string CurrentDateTimeToString() {
     std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
     std::string output(30, '\0');
@@ -14,6 +18,7 @@ std::string CurrentDateTimeToString() {
 }
 
 void Logger::Log(const std::string& message) {
+    std::lock_guard<std::mutex> lock(logMutex);
     LogEntry logEntry;
     logEntry.type = LOG_INFO;
     logEntry.message = "LOG: [" + CurrentDateTimeToString() + "]: " + message;
@@ -23,6 +28,7 @@ void Logger::Log(const std::string& message) {
 }
 
 void Logger::Err(const std::string& message) {
+    std::lock_guard<std::mutex> lock(logMutex);
     LogEntry logEntry;
     logEntry.type = LOG_ERROR;
     logEntry.message = "ERR: [" + CurrentDateTimeToString() + "]: " + message;
@@ -0,0 +1,119 @@
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator for memory that only lives until the end of the frame.
+// Allocating moves an offset forward, nothing is freed until Reset releases
+// everything at once. A frame that outgrows the block gets overflow blocks
+// from the heap, and the next Reset grows the block past the high-water mark
+// so that the following frames fit in it again.
+//
+// Allocate takes a lock, so systems running at the same time can share the
+// arena. Allocations are meant to be whole buffers, a few per system.
+class FrameArena {
+ private:
+  std::unique_ptr<unsigned char[]> block;
+  size_t capacity;
+  size_t offset = 0;
+  std::vector<std::unique_ptr<unsigned char[]>> overflowBlocks;
+
+  // Bytes handed out during the current and the last frame, alignment
+  // padding included, and the most handed out by a single frame
+  size_t frameBytes = 0;
+  size_t lastFrameBytes = 0;
+  size_t highWaterBytes = 0;
+
+  std::mutex mutex;
+
+ public:
+  explicit FrameArena(size_t capacity = 1024 * 1024)
+      : block(std::make_unique<unsigned char[]>(capacity)), capacity(capacity) {}
+  FrameArena(const FrameArena&) = delete;
+  FrameArena& operator=(const FrameArena&) = delete;
+
+  void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(block.get());
+    const std::uintptr_t address = (base + offset + alignment - 1) / alignment * alignment;
+    if (address + size <= base + capacity) {
+      frameBytes += address + size - (base + offset);
+      offset = address + size - base;
+      return reinterpret_cast<void*>(address);
+    }
+
+    // Does not fit, this frame uses a block of its own for it
+    overflowBlocks.push_back(std::make_unique<unsigned char[]>(size + alignment));
+    const std::uintptr_t overflowBase = reinterpret_cast<std::uintptr_t>(overflowBlocks.back().get());
+    frameBytes += size + alignment;
+    return reinterpret_cast<void*>((overflowBase + alignment - 1) / alignment * alignment);
+  }
+
+  // Uninitialized room for count objects of T, which are never destroyed
+  template <typename T>
+  T* AllocateArray(size_t count) {
+    static_assert(std::is_trivially_destructible<T>::value, "Frame arena objects are never destroyed");
+    return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+  }
+
+  // Releases every allocation of the frame. Must not run while a system
+  // still uses memory from the arena.
+  void Reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    lastFrameBytes = frameBytes;
+    highWaterBytes = std::max(highWaterBytes, frameBytes);
+
+    if (!overflowBlocks.empty()) {
+      overflowBlocks.clear();
+      capacity = std::max(capacity * 2, highWaterBytes);
+      block = std::make_unique<unsigned char[]>(capacity);
+    }
+    offset = 0;
+    frameBytes = 0;
+  }
+
+  size_t GetCapacity() const { return capacity; }
+  size_t GetFrameBytes() const { return frameBytes; }
+  size_t GetLastFrameBytes() const { return lastFrameBytes; }
+  size_t GetHighWaterBytes() const { return highWaterBytes; }
+};
+
+// Standard allocator over a frame arena, for transient containers such as
+// FrameVector. Deallocating does nothing, reserve up front where the size is
+// known so that growing does not leave old buffers behind in the arena.
+template <typename T>
+class ArenaAllocator {
+ private:
+  FrameArena* arena;
+
+  template <typename U>
+  friend class ArenaAllocator;
+
+ public:
+  using value_type = T;
+
+  ArenaAllocator(FrameArena& arena) : arena(&arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+  T* allocate(size_t n) { return static_cast<T*>(arena->Allocate(n * sizeof(T), alignof(T))); }
+  void deallocate(T*, size_t) {}
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
+
+template <typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif
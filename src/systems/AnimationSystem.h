@@ -2,6 +2,7 @@
 #define ANIMATIONSYSTEM_H
 
 #include "../ecs/ECS.h"
+#include "../components/Components.h"
 #include "../components/AnimationComponent.h"
 #include "../components/SpriteComponent.h"
 #include "../logger/Logger.h"
@@ -13,17 +14,24 @@ class AnimationSystem : public System {
             RequireComponent<SpriteComponent>();
         }
 
-        void Update(double deltaTime) {
-            for (auto entity : GetSystemEntities()) {
-                auto& animation = entity.GetComponent<AnimationComponent>();
-                auto& sprite = entity.GetComponent<SpriteComponent>();
+        void Update(double deltaTime, Registry& registry, JobSystem& jobSystem) {
+            const int ticks = SDL_GetTicks();
 
-                animation.currentFrame = ((SDL_GetTicks() - animation.startTime) 
-                * animation.frameSpeedRate / 1000) % animation.numFrames;
+            // Read-only view, so that only the sprites whose frame moved
+            // are stamped as changed
+            registry.View<const AnimationComponent, const SpriteComponent>().ParallelEach(jobSystem,
+                [ticks, &registry](Entity entity, const AnimationComponent& animation, const SpriteComponent& sprite) {
+                    const int currentFrame = ((ticks - animation.startTime)
+                    * animation.frameSpeedRate / 1000) % animation.numFrames;
+                    if (currentFrame != animation.currentFrame) {
+                        registry.GetMutableComponent<AnimationComponent>(entity).currentFrame = currentFrame;
+                    }
 
-
-                sprite.srcRect.x = animation.currentFrame * sprite.width;
-            }
+                    const int srcRectX = currentFrame * sprite.width;
+                    if (srcRectX != sprite.srcRect.x) {
+                        registry.GetMutableComponent<SpriteComponent>(entity).srcRect.x = srcRectX;
+                    }
+                });
         }
 };
 
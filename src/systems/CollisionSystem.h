@@ -4,32 +4,45 @@
 #include "../components/BoxColliderComponent.h"
 #include "../components/TransformComponent.h"
 #include "../ecs/ECS.h"
-#include "../logger/Logger.h"
+#include "../components/Components.h"
+#include "../eventbus/EventBus.h"
+#include "../events/CollisionEvent.h"
+#include "../memory/FrameArena.h"
+#include <vector>
 
 class CollisionSystem : public System {
  public:
 
   CollisionSystem() {
-    RequireComponent<TransformComponent>();
-    RequireComponent<BoxColliderComponent>();
+    RequireComponent<TransformComponent>(ACCESS_READ);
+    RequireComponent<BoxColliderComponent>(ACCESS_READ);
   }
   
-  void Update(double deltaTime) {
-    auto entities = GetSystemEntities();
-    for (auto i = entities.begin(); i != entities.end(); i++) {
-      Entity a = *i;
-      auto aTransform = a.GetComponent<TransformComponent>();
-      auto aCollider = a.GetComponent<BoxColliderComponent>();
-
-      for (auto j = i; j != entities.end(); j++) {
-        Entity b = *j;
-
-        if(a == b) {
-            continue;
-        }
+  void Update(double deltaTime, Registry& registry, EventBus& eventBus, FrameArena& frameArena) {
+    if (!eventBus.HasSubscribers<CollisionEvent>()) {
+      return;
+    }
+
+    struct CollidableEntity {
+      Entity entity;
+      const TransformComponent* transform;
+      const BoxColliderComponent* collider;
+    };
+
+    FrameVector<CollidableEntity> collidables(frameArena);
+    collidables.reserve(GetSystemEntities().size());
+    registry.View<const TransformComponent, const BoxColliderComponent>().Each(
+        [&collidables](Entity entity, const TransformComponent& transform, const BoxColliderComponent& collider) {
+          collidables.push_back({entity, &transform, &collider});
+        });
+
+    for (auto i = collidables.begin(); i != collidables.end(); i++) {
+      const auto& aTransform = *i->transform;
+      const auto& aCollider = *i->collider;
 
-        auto bTransform = b.GetComponent<TransformComponent>();
-        auto bCollider = b.GetComponent<BoxColliderComponent>();
+      for (auto j = i + 1; j != collidables.end(); j++) {
+        const auto& bTransform = *j->transform;
+        const auto& bCollider = *j->collider;
 
         bool hasCollision = CheckAABBCollision(
             aTransform.position.x + aCollider.offset.x,
@@ -43,7 +56,7 @@ class CollisionSystem : public System {
         );
 
         if(hasCollision) {
-            Logger::Log("Collision!");
+            eventBus.Emit<CollisionEvent>(i->entity, j->entity);
         }
 
       }
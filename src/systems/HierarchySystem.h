@@ -0,0 +1,217 @@
+#ifndef HIERARCHYSYSTEM_H
+#define HIERARCHYSYSTEM_H
+
+#include "../ecs/ECS.h"
+#include "../components/Components.h"
+#include "../components/TransformComponent.h"
+#include "../components/HierarchyComponent.h"
+#include "../logger/Logger.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Computes the world transform of the entities attached to a parent, and of
+// the parents themselves. The nodes are stored in depth-first order, so that
+// a parent always comes before its children and the subtree of node i is the
+// range [i, subtreeEnds[i]). Only the subtrees whose transforms changed since
+// the last update are recomputed.
+class HierarchySystem : public System {
+    private:
+        std::vector<Entity> nodeEntities;
+        std::vector<int> parentIndices;
+        std::vector<int> subtreeEnds;
+        std::vector<TransformComponent> worldTransforms;
+        std::vector<int> rootNodes;
+        // Node of every entity id, or -1
+        std::vector<int> entityIdToNode;
+        std::vector<int> dirtyNodes;
+        // Membership version the nodes were built from, the count alone
+        // misses an entity leaving while another one joins
+        unsigned int builtMembershipVersion = 0;
+        unsigned int lastRunTick = 0;
+
+        bool NeedsRebuild(Registry& registry) const {
+            if (GetMembershipVersion() != builtMembershipVersion) {
+                return true;
+            }
+
+            for (auto root : rootNodes) {
+                if (!registry.HasComponent<TransformComponent>(nodeEntities[root])) {
+                    return true;
+                }
+            }
+
+            bool parentChanged = false;
+            registry.View<const HierarchyComponent>().Changed<HierarchyComponent>(lastRunTick).Each(
+                [&parentChanged](Entity, const HierarchyComponent&) {
+                    parentChanged = true;
+                });
+            return parentChanged;
+        }
+
+        void Rebuild(Registry& registry) {
+            // (parent id, child) pairs sorted by parent, children whose parent
+            // is gone are roots of their own tree
+            std::vector<std::pair<int, Entity>> links;
+            for (auto child : GetSystemEntities()) {
+                const Entity parent = registry.GetComponent<HierarchyComponent>(child).parent;
+                const bool hasParent = !(parent == child) && registry.HasComponent<TransformComponent>(parent);
+                links.push_back({hasParent ? parent.GetId() : -1, child});
+            }
+            std::sort(links.begin(), links.end());
+
+            nodeEntities.clear();
+            parentIndices.clear();
+            rootNodes.clear();
+            std::fill(entityIdToNode.begin(), entityIdToNode.end(), -1);
+
+            auto addTree = [&](Entity root) {
+                std::vector<std::pair<Entity, int>> stack = {{root, -1}};
+
+                while (!stack.empty()) {
+                    const auto [entity, parentIndex] = stack.back();
+                    stack.pop_back();
+
+                    const int node = nodeEntities.size();
+                    GrowToFit(entityIdToNode, entity.GetId(), -1);
+                    entityIdToNode[entity.GetId()] = node;
+                    nodeEntities.push_back(entity);
+                    parentIndices.push_back(parentIndex);
+
+                    auto first = std::lower_bound(links.begin(), links.end(), std::make_pair(entity.GetId(), Entity(-1, 0)));
+                    auto last = first;
+                    while (last != links.end() && last->first == entity.GetId()) {
+                        last++;
+                    }
+                    // Reversed, so that the children are visited in order
+                    for (auto link = last; link != first; link--) {
+                        stack.push_back({(link - 1)->second, node});
+                    }
+                }
+            };
+
+            for (unsigned int i = 0; i < links.size(); i++) {
+                const int parentId = links[i].first;
+
+                if (parentId == -1) {
+                    rootNodes.push_back(nodeEntities.size());
+                    addTree(links[i].second);
+                } else if ((i == 0 || links[i - 1].first != parentId) &&
+                           !HasEntity(registry.GetEntity(parentId))) {
+                    rootNodes.push_back(nodeEntities.size());
+                    addTree(registry.GetEntity(parentId));
+                }
+            }
+
+            // Entities attached in a loop are not reachable from any root
+            if (nodeEntities.size() < links.size()) {
+                Logger::Err("Hierarchy has a cycle, " + std::to_string(links.size() - nodeEntities.size()) +
+                            " entities are not attached");
+            }
+
+            // Children come after their parent, so walking backwards sums the
+            // size of every subtree before it is added to its parent
+            subtreeEnds.assign(nodeEntities.size(), 1);
+            for (int node = nodeEntities.size() - 1; node > 0; node--) {
+                if (parentIndices[node] != -1) {
+                    subtreeEnds[parentIndices[node]] += subtreeEnds[node];
+                }
+            }
+            for (unsigned int node = 0; node < nodeEntities.size(); node++) {
+                subtreeEnds[node] += node;
+            }
+
+            worldTransforms.resize(nodeEntities.size());
+            builtMembershipVersion = GetMembershipVersion();
+        }
+
+        void UpdateWorldTransform(int node, Registry& registry) {
+            // The transform may be removed during the frame, before the
+            // membership change that triggers the rebuild dropping the node
+            if (!registry.HasComponent<TransformComponent>(nodeEntities[node])) {
+                return;
+            }
+
+            const auto& local = registry.GetComponent<TransformComponent>(nodeEntities[node]);
+            auto& world = worldTransforms[node];
+            const int parent = parentIndices[node];
+
+            if (parent == -1) {
+                world = local;
+                return;
+            }
+
+            const auto& parentWorld = worldTransforms[parent];
+            const double angle = glm::radians(parentWorld.rotation);
+            const glm::vec2 offset = local.position * parentWorld.scale;
+
+            world.position = parentWorld.position + glm::vec2(
+                offset.x * std::cos(angle) - offset.y * std::sin(angle),
+                offset.x * std::sin(angle) + offset.y * std::cos(angle));
+            world.scale = parentWorld.scale * local.scale;
+            world.rotation = parentWorld.rotation + local.rotation;
+        }
+
+    public:
+        HierarchySystem() {
+            RequireComponent<TransformComponent>(ACCESS_READ);
+            RequireComponent<HierarchyComponent>(ACCESS_READ);
+        }
+
+        void Update(Registry& registry) {
+            if (NeedsRebuild(registry)) {
+                Rebuild(registry);
+                for (unsigned int node = 0; node < nodeEntities.size(); node++) {
+                    UpdateWorldTransform(node, registry);
+                }
+                lastRunTick = registry.GetChangeTick();
+                return;
+            }
+
+            // Nodes whose local transform changed, children first and then roots
+            dirtyNodes.clear();
+            registry.View<const TransformComponent, const HierarchyComponent>().Changed<TransformComponent>(lastRunTick).Each(
+                [this](Entity entity, const TransformComponent&, const HierarchyComponent&) {
+                    // Entities caught in a cycle have no node
+                    if (entity.GetId() < static_cast<int>(entityIdToNode.size()) && entityIdToNode[entity.GetId()] != -1) {
+                        dirtyNodes.push_back(entityIdToNode[entity.GetId()]);
+                    }
+                });
+            const int transformId = Component<TransformComponent>::GetId();
+            for (auto root : rootNodes) {
+                if (registry.GetChangedTick(nodeEntities[root].GetId(), transformId) > lastRunTick) {
+                    dirtyNodes.push_back(root);
+                }
+            }
+            std::sort(dirtyNodes.begin(), dirtyNodes.end());
+
+            // Recompute each dirty subtree once, skipping the dirty nodes
+            // that lie inside a subtree already recomputed
+            int updatedEnd = 0;
+            for (auto dirtyNode : dirtyNodes) {
+                if (dirtyNode < updatedEnd) {
+                    continue;
+                }
+                for (int node = dirtyNode; node < subtreeEnds[dirtyNode]; node++) {
+                    UpdateWorldTransform(node, registry);
+                }
+                updatedEnd = subtreeEnds[dirtyNode];
+            }
+
+            lastRunTick = registry.GetChangeTick();
+        }
+
+        // World transform of an entity that has a parent or children, or
+        // nullptr for the entities outside of any hierarchy
+        const TransformComponent* GetWorldTransform(Entity entity) const {
+            const int entityId = entity.GetId();
+            if (entityId >= static_cast<int>(entityIdToNode.size()) || entityIdToNode[entityId] == -1) {
+                return nullptr;
+            }
+
+            const int node = entityIdToNode[entityId];
+            return nodeEntities[node] == entity ? &worldTransforms[node] : nullptr;
+        }
+};
+
+#endif
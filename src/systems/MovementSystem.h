@@ -2,6 +2,7 @@
 #define MOVEMENTSYSTEM_H
 
 #include "../ecs/ECS.h"
+#include "../components/Components.h"
 #include "../components/TransformComponent.h"
 #include "../components/RigidBodyComponent.h"
 #include "../logger/Logger.h"
@@ -10,17 +11,14 @@ class MovementSystem : public System {
     public:
         MovementSystem() {
             RequireComponent<TransformComponent>();
-            RequireComponent<RigidBodyComponent>();
+            RequireComponent<RigidBodyComponent>(ACCESS_READ);
         }
-        void Update(double deltaTime) {
-            for (auto entity : GetSystemEntities()) {
-                auto& transform = entity.GetComponent<TransformComponent>();
-                const auto rigidBody = entity.GetComponent<RigidBodyComponent>();
-
-                transform.position.x += rigidBody.velocity.x * deltaTime;
-                transform.position.y += rigidBody.velocity.y * deltaTime;
-
-            }
+        void Update(double deltaTime, Registry& registry, JobSystem& jobSystem) {
+            registry.View<TransformComponent, const RigidBodyComponent>().ParallelEach(jobSystem,
+                [deltaTime](Entity, TransformComponent& transform, const RigidBodyComponent& rigidBody) {
+                    transform.position.x += rigidBody.velocity.x * deltaTime;
+                    transform.position.y += rigidBody.velocity.y * deltaTime;
+                });
         }
 };
 
@@ -2,58 +2,127 @@
 #define RENDERSYSTEM_H
 
 #include "../ecs/ECS.h"
+#include "../components/Components.h"
 #include "../components/TransformComponent.h"
 #include "../components/RigidBodyComponent.h"
 #include "../components/SpriteComponent.h"
+#include "HierarchySystem.h"
 #include <memory>
+#include <vector>
 #include <algorithm>
 
 class RenderSystem : public System {
-    public:
-        RenderSystem() {
-            RequireComponent<TransformComponent>();
-            RequireComponent<SpriteComponent>();
+    private:
+        struct RenderableEntity {
+            Entity entity;
+            int zIndex;
+        };
+
+        // Entities in draw order, kept across frames so that it is only
+        // re-sorted when a sprite is added or its zIndex changes
+        std::vector<RenderableEntity> renderQueue;
+        // Position of every entity in renderQueue, or -1
+        std::vector<int> entityIdToQueueIndex;
+        unsigned int lastRunTick = 0;
+
+        void Draw(SDL_Renderer* renderer, std::unique_ptr<AssetStore>& assetStore, const TransformComponent& transform, const SpriteComponent& sprite) {
+            SDL_Rect srcRect = sprite.srcRect; 
+            SDL_Rect dstRect = {
+                static_cast<int>(transform.position.x),
+                static_cast<int>(transform.position.y),
+                static_cast<int>(sprite.width * transform.scale.x),
+                static_cast<int>(sprite.height * transform.scale.y),
+            };
+
+            SDL_RenderCopyEx(
+                renderer, 
+                assetStore->GetTexture(sprite.texture),
+                &srcRect,
+                &dstRect,
+                transform.rotation,
+                NULL,
+                SDL_FLIP_NONE
+            );
         }
 
-        void Update(SDL_Renderer* renderer, std::unique_ptr<AssetStore>& assetStore) {
-            struct RenderableEntity {
-                TransformComponent transformComponent;
-                SpriteComponent spriteComponent;
+        void UpdateRenderQueue(Registry& registry) {
+            bool needsSort = false;
+
+            auto enqueue = [this, &needsSort](Entity entity, const TransformComponent&, const SpriteComponent& sprite) {
+                GrowToFit(entityIdToQueueIndex, entity.GetId(), -1);
+                int& index = entityIdToQueueIndex[entity.GetId()];
+
+                if (index != -1 && renderQueue[index].entity == entity) {
+                    if (renderQueue[index].zIndex != sprite.zIndex) {
+                        renderQueue[index].zIndex = sprite.zIndex;
+                        needsSort = true;
+                    }
+                    return;
+                }
+
+                index = renderQueue.size();
+                renderQueue.push_back({entity, sprite.zIndex});
+                needsSort = true;
             };
 
-            std::vector<RenderableEntity> renderableEntities;
-            for (auto entity : GetSystemEntities()) {
-                RenderableEntity e;
-                e.spriteComponent = entity.GetComponent<SpriteComponent>();
-                e.transformComponent = entity.GetComponent<TransformComponent>();
+            // New and modified sprites, then entities that only now got a transform
+            registry.View<const TransformComponent, const SpriteComponent>()
+                .Changed<SpriteComponent>(lastRunTick).Each(enqueue);
+            registry.View<const TransformComponent, const SpriteComponent>()
+                .Added<TransformComponent>(lastRunTick).Each(enqueue);
+
+            if (needsSort) {
+                std::stable_sort(renderQueue.begin(), renderQueue.end(), [](const RenderableEntity& a, const RenderableEntity& b) {
+                    return a.zIndex < b.zIndex;
+                });
+                for (unsigned int i = 0; i < renderQueue.size(); i++) {
+                    entityIdToQueueIndex[renderQueue[i].entity.GetId()] = i;
+                }
+            }
+
+            // Drop the entities that were killed or lost a component
+            int numQueued = 0;
+            for (int i = 0; i < static_cast<int>(renderQueue.size()); i++) {
+                const Entity entity = renderQueue[i].entity;
 
-                renderableEntities.emplace_back(e);
+                if (!registry.HasComponent<TransformComponent>(entity) || !registry.HasComponent<SpriteComponent>(entity)) {
+                    if (entityIdToQueueIndex[entity.GetId()] == i) {
+                        entityIdToQueueIndex[entity.GetId()] = -1;
+                    }
+                    continue;
+                }
+                renderQueue[numQueued] = renderQueue[i];
+                entityIdToQueueIndex[entity.GetId()] = numQueued++;
             }
-            std::sort(renderableEntities.begin(), renderableEntities.end(), [](const RenderableEntity& a, const RenderableEntity& b) {
-                return a.spriteComponent.zIndex < b.spriteComponent.zIndex;
-            });
-
-            for (auto entity : renderableEntities) {
-                const auto transform = entity.transformComponent;
-                const auto sprite = entity.spriteComponent;
-
-                SDL_Rect srcRect = sprite.srcRect; 
-                SDL_Rect dstRect = {
-                    static_cast<int>(transform.position.x),
-                    static_cast<int>(transform.position.y),
-                    static_cast<int>(sprite.width * transform.scale.x),
-                    static_cast<int>(sprite.height * transform.scale.y),
-                };
-
-                SDL_RenderCopyEx(
-                    renderer, 
-                    assetStore->GetTexture(sprite.assetId),
-                    &srcRect,
-                    &dstRect,
-                    transform.rotation,
-                    NULL,
-                    SDL_FLIP_NONE
-                );
+            renderQueue.erase(renderQueue.begin() + numQueued, renderQueue.end());
+
+            // Rendering comes after every system that writes sprites, so
+            // everything stamped this frame has been seen
+            lastRunTick = registry.GetChangeTick();
+        }
+
+    public:
+        RenderSystem() {
+            RequireComponent<TransformComponent>(ACCESS_READ);
+            RequireComponent<SpriteComponent>(ACCESS_READ);
+        }
+
+        void Update(SDL_Renderer* renderer, std::unique_ptr<AssetStore>& assetStore, Registry& registry) {
+            // Entities attached to a parent are drawn at their world transform
+            const HierarchySystem* hierarchySystem =
+                registry.HasSystem<HierarchySystem>() ? &registry.GetSystem<HierarchySystem>() : nullptr;
+
+            auto draw = [&](Entity entity, const TransformComponent& transform, const SpriteComponent& sprite) {
+                const TransformComponent* worldTransform =
+                    hierarchySystem ? hierarchySystem->GetWorldTransform(entity) : nullptr;
+                Draw(renderer, assetStore, worldTransform ? *worldTransform : transform, sprite);
+            };
+
+            UpdateRenderQueue(registry);
+            for (const auto& renderable : renderQueue) {
+                draw(renderable.entity,
+                     registry.GetComponent<TransformComponent>(renderable.entity),
+                     registry.GetComponent<SpriteComponent>(renderable.entity));
             }
         }
 };
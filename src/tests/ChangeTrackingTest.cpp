@@ -0,0 +1,65 @@
+#include <vector>
+
+#include "Test.h"
+#include "../ecs/ECS.h"
+
+struct Value {
+  int value;
+  Value(int value = 0) : value(value) {}
+};
+
+static std::vector<int> GetChangedIds(Registry& registry, unsigned int sinceTick) {
+  std::vector<int> ids;
+  registry.View<const Value>().Changed<Value>(sinceTick).Each([&ids](Entity entity, const Value&) {
+    ids.push_back(entity.GetId());
+  });
+  return ids;
+}
+
+// A system that reads through a const view and marks only what it writes
+// leaves the other entities out of Changed
+static void TestUntouchedEntityIsSkipped(StorageType storageType) {
+  Registry registry(storageType);
+  const Entity touched = registry.CreateEntity();
+  const Entity untouched = registry.CreateEntity();
+  registry.AddComponent<Value>(touched, 0);
+  registry.AddComponent<Value>(untouched, 1);
+  registry.Update();
+  registry.AdvanceTick();
+  const unsigned int lastRunTick = registry.GetChangeTick();
+  registry.AdvanceTick();
+
+  registry.View<const Value>().Each([&registry](Entity entity, const Value& value) {
+    if (value.value == 0) {
+      registry.GetMutableComponent<Value>(entity).value = 2;
+    }
+  });
+
+  const std::vector<int> expected = {touched.GetId()};
+  CHECK(GetChangedIds(registry, lastRunTick) == expected);
+}
+
+// Listing the component non-const stamps every yielded entity, written or not
+static void TestMutableViewStampsEveryEntity(StorageType storageType) {
+  Registry registry(storageType);
+  const Entity first = registry.CreateEntity();
+  const Entity second = registry.CreateEntity();
+  registry.AddComponent<Value>(first, 0);
+  registry.AddComponent<Value>(second, 1);
+  registry.Update();
+  registry.AdvanceTick();
+  const unsigned int lastRunTick = registry.GetChangeTick();
+  registry.AdvanceTick();
+
+  registry.View<Value>().Each([](Entity, Value&) {});
+
+  CHECK(GetChangedIds(registry, lastRunTick).size() == 2);
+}
+
+int main() {
+  for (StorageType storageType : {STORAGE_POOL, STORAGE_ARCHETYPE}) {
+    TestUntouchedEntityIsSkipped(storageType);
+    TestMutableViewStampsEveryEntity(storageType);
+  }
+  return ReportChecks("ChangeTrackingTest");
+}
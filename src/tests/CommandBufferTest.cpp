@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "Test.h"
+#include "../ecs/ECS.h"
+
+struct Value {
+  int value;
+  Value(int value = 0) : value(value) {}
+};
+
+// (entity id, value) of every entity with a Value, and the value of target
+struct ReplayResult {
+  std::vector<std::pair<int, int>> values;
+  int targetValue;
+
+  bool operator==(const ReplayResult& other) const {
+    return values == other.values && targetValue == other.targetValue;
+  }
+};
+
+// Two jobs spawn from the same source and write the same target. Which
+// thread, and so which buffer, runs which job must not matter.
+static ReplayResult ReplayConflictingJobs(int bufferOfFirstJob, int bufferOfSecondJob, size_t& numMessages) {
+  Registry registry;
+  registry.CreateCommandBuffers(2);
+  const Entity source = registry.CreateEntity();
+  const Entity target = registry.CreateEntity();
+  registry.AddComponent<Value>(target, 0);
+  registry.Update();
+  numMessages = Logger::messages.size();
+
+  // Recorded second job first, as a thread that stole it could
+  CommandBuffer& second = registry.GetCommandBuffer(bufferOfSecondJob);
+  second.SetJobKey(CommandBuffer::MakeJobKey(0, 1));
+  const Entity secondSpawn = second.CreateEntity(source);
+  second.AddComponent<Value>(secondSpawn, 2);
+  // Spawned by an entity of the same buffer, sorted like its source
+  const Entity secondChild = second.CreateEntity(secondSpawn);
+  second.AddComponent<Value>(secondChild, 3);
+  second.AddComponent<Value>(target, 20);
+
+  CommandBuffer& first = registry.GetCommandBuffer(bufferOfFirstJob);
+  first.SetJobKey(CommandBuffer::MakeJobKey(0, 0));
+  const Entity firstSpawn = first.CreateEntity(source);
+  first.AddComponent<Value>(firstSpawn, 1);
+  first.AddComponent<Value>(target, 10);
+
+  registry.Update();
+
+  ReplayResult result;
+  registry.View<const Value>().Each([&result](Entity entity, const Value& value) {
+    result.values.push_back({entity.GetId(), value.value});
+  });
+  std::sort(result.values.begin(), result.values.end());
+  result.targetValue = registry.GetComponent<Value>(target).value;
+  return result;
+}
+
+static void TestReplayDoesNotDependOnThreads() {
+  size_t numMessages = 0;
+  const ReplayResult result = ReplayConflictingJobs(0, 1, numMessages);
+  CHECK(!HasLoggedError(numMessages));
+  const ReplayResult swapped = ReplayConflictingJobs(1, 0, numMessages);
+  CHECK(!HasLoggedError(numMessages));
+
+  CHECK(result == swapped);
+  // The job with the larger key writes last
+  CHECK(result.targetValue == 20);
+  // Spawned in job key order: source, then the first job, then the second
+  const std::vector<std::pair<int, int>> expected = {{1, 20}, {2, 1}, {3, 2}, {4, 3}};
+  CHECK(result.values == expected);
+}
+
+static void TestSameJobKeyOnTwoThreadsIsReported() {
+  Registry registry;
+  registry.CreateCommandBuffers(2);
+  const Entity target = registry.CreateEntity();
+  registry.Update();
+  const size_t numMessages = Logger::messages.size();
+
+  registry.GetCommandBuffer(0).AddComponent<Value>(target, 1);
+  registry.GetCommandBuffer(1).AddComponent<Value>(target, 2);
+  registry.Update();
+
+  CHECK(HasLoggedError(numMessages));
+}
+
+int main() {
+  TestReplayDoesNotDependOnThreads();
+  TestSameJobKeyOnTwoThreadsIsReported();
+  return ReportChecks("CommandBufferTest");
+}
@@ -0,0 +1,50 @@
+#include <vector>
+
+#include "Test.h"
+#include "../ecs/ECS.h"
+
+struct Value {
+  int value;
+  Value(int value = 0) : value(value) {}
+};
+
+static void TestCreateEntities() {
+  Registry registry;
+  const std::vector<Entity> entities = registry.CreateEntities(3);
+  registry.Update();
+
+  CHECK(entities.size() == 3);
+  for (const Entity entity : entities) {
+    CHECK(registry.Valid(entity));
+  }
+}
+
+static void TestCountIsNotPositive() {
+  Registry registry;
+  const Entity prefab = registry.CreateEntity();
+  registry.AddComponent<Value>(prefab, 1);
+  registry.Update();
+
+  for (int count : {0, -1}) {
+    size_t numMessages = Logger::messages.size();
+    CHECK(registry.CreateEntities(count).empty());
+    CHECK(HasLoggedError(numMessages));
+
+    numMessages = Logger::messages.size();
+    CHECK(registry.Instantiate(prefab, count).empty());
+    CHECK(HasLoggedError(numMessages));
+  }
+  registry.Update();
+
+  // No id was handed out, nor any copy of the component made
+  CHECK(registry.CreateEntity().GetId() == prefab.GetId() + 1);
+  int numValues = 0;
+  registry.View<const Value>().Each([&numValues](Entity, const Value&) { numValues++; });
+  CHECK(numValues == 1);
+}
+
+int main() {
+  TestCreateEntities();
+  TestCountIsNotPositive();
+  return ReportChecks("CreateEntitiesTest");
+}
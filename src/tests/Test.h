@@ -0,0 +1,35 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <cstddef>
+#include <cstdio>
+
+#include "../logger/Logger.h"
+
+// Checks failed so far, the test executable fails when it is not 0
+inline int numFailedChecks = 0;
+
+#define CHECK(condition)                                                            \
+  do {                                                                              \
+    if (!(condition)) {                                                             \
+      std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);    \
+      numFailedChecks++;                                                            \
+    }                                                                               \
+  } while (0)
+
+// Whether an error was logged after the first numMessages messages
+inline bool HasLoggedError(size_t numMessages) {
+  for (size_t i = numMessages; i < Logger::messages.size(); i++) {
+    if (Logger::messages[i].type == LOG_ERROR) {
+      return true;
+    }
+  }
+  return false;
+}
+
+inline int ReportChecks(const char* testName) {
+  std::printf("%s: %s\n", testName, numFailedChecks == 0 ? "passed" : "FAILED");
+  return numFailedChecks == 0 ? 0 : 1;
+}
+
+#endif